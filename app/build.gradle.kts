@@ -1,8 +1,151 @@
+import java.awt.image.BufferedImage
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import javax.imageio.ImageIO
+import javax.sound.sampled.AudioFormat
+import javax.sound.sampled.AudioSystem
+
 plugins {
     id("com.android.application")
     id("org.jetbrains.kotlin.android")
 }
 
+/**
+ * Packs the textures and sounds loaded at startup into one bundle, already decoded and processed,
+ * so the game can map them with a single asset open. The layout is described in AssetBundle.h.
+ */
+abstract class PackAssetsTask : DefaultTask() {
+
+    /** Asset path to TextureAsset processing mode (0 = none, 1 = remove white, 2 = glyph mask). */
+    @get:Input
+    abstract val textures: MapProperty<String, Int>
+
+    @get:Input
+    abstract val sounds: ListProperty<String>
+
+    @get:InputDirectory
+    abstract val assetsDirectory: DirectoryProperty
+
+    @get:OutputDirectory
+    abstract val outputDirectory: DirectoryProperty
+
+    private class Entry(
+        val name: String,
+        val kind: Int,
+        val mode: Int,
+        val format: Int,
+        val width: Int,
+        val height: Int,
+        val data: ByteArray
+    )
+
+    @TaskAction
+    fun pack() {
+        val assets = assetsDirectory.get().asFile
+        val entries = textures.get().map { (path, mode) -> packTexture(path, mode, ImageIO.read(assets.resolve(path))) } +
+                sounds.get().map { path -> packSound(path, assets.resolve(path)) }
+
+        // Header, table of contents, then the data, each entry aligned to 64 bytes.
+        val tocEnd = HEADER_SIZE + entries.size * ENTRY_SIZE
+        val offsets = mutableListOf<Int>()
+        var end = tocEnd
+        for (entry in entries) {
+            end = align(end)
+            offsets.add(end)
+            end += entry.data.size
+        }
+
+        val bundle = ByteBuffer.allocate(end).order(ByteOrder.LITTLE_ENDIAN)
+        bundle.put("PPAK".toByteArray(Charsets.US_ASCII))
+        bundle.putInt(VERSION)
+        bundle.putInt(entries.size)
+        bundle.putInt(0)
+        entries.forEachIndexed { i, entry ->
+            val name = entry.name.toByteArray(Charsets.UTF_8)
+            require(name.size < NAME_SIZE) { "Asset path too long to pack: ${entry.name}" }
+            bundle.put(name)
+            bundle.put(ByteArray(NAME_SIZE - name.size))
+            bundle.putInt(entry.kind)
+            bundle.putInt(entry.mode)
+            bundle.putInt(entry.format)
+            bundle.putInt(entry.width)
+            bundle.putInt(entry.height)
+            bundle.putInt(offsets[i])
+            bundle.putInt(entry.data.size)
+        }
+        entries.forEachIndexed { i, entry ->
+            bundle.position(offsets[i])
+            bundle.put(entry.data)
+        }
+
+        outputDirectory.get().asFile.resolve(BUNDLE_NAME).writeBytes(bundle.array())
+    }
+
+    /** Mirrors the processing and format choice in TextureAsset::loadAsset. */
+    private fun packTexture(path: String, mode: Int, image: BufferedImage): Entry {
+        val width = image.width
+        val height = image.height
+        val pixels = image.getRGB(0, 0, width, height, null, 0, width)
+        return when {
+            mode == 2 -> {
+                // Black pixels become the mask, everything else is clear.
+                val data = ByteArray(pixels.size) { i -> if ((pixels[i] and 0xffffff) == 0) 0xff.toByte() else 0 }
+                Entry(path, KIND_TEXTURE, mode, FORMAT_R8, width, height, data)
+            }
+            mode == 0 && !image.colorModel.hasAlpha() -> {
+                val data = ByteBuffer.allocate(pixels.size * 2).order(ByteOrder.LITTLE_ENDIAN)
+                for (argb in pixels) {
+                    val r = (argb shr 16) and 0xff
+                    val g = (argb shr 8) and 0xff
+                    val b = argb and 0xff
+                    data.putShort((((r shr 3) shl 11) or ((g shr 2) shl 5) or (b shr 3)).toShort())
+                }
+                Entry(path, KIND_TEXTURE, mode, FORMAT_RGB565, width, height, data.array())
+            }
+            else -> {
+                val data = ByteArray(pixels.size * 4)
+                pixels.forEachIndexed { i, argb ->
+                    val r = (argb shr 16) and 0xff
+                    val g = (argb shr 8) and 0xff
+                    val b = argb and 0xff
+                    val keyed = mode == 1 && r > 0xf0 && g > 0xf0 && b > 0xf0
+                    data[i * 4] = r.toByte()
+                    data[i * 4 + 1] = g.toByte()
+                    data[i * 4 + 2] = b.toByte()
+                    data[i * 4 + 3] = if (keyed) 0 else (argb ushr 24).toByte()
+                }
+                Entry(path, KIND_TEXTURE, mode, FORMAT_RGBA8, width, height, data)
+            }
+        }
+    }
+
+    /** Converts a sound to interleaved signed 16-bit little endian PCM at its own rate. */
+    private fun packSound(path: String, file: java.io.File): Entry {
+        AudioSystem.getAudioInputStream(file).use { source ->
+            val format = source.format
+            val target = AudioFormat(format.sampleRate, 16, format.channels, true, false)
+            val data = AudioSystem.getAudioInputStream(target, source).use { it.readBytes() }
+            return Entry(path, KIND_SOUND, 0, 0, format.channels, format.sampleRate.toInt(), data)
+        }
+    }
+
+    private fun align(offset: Int) = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT
+
+    companion object {
+        const val BUNDLE_NAME = "patplay.pak"
+        const val VERSION = 1
+        const val HEADER_SIZE = 16
+        const val ENTRY_SIZE = 64
+        const val NAME_SIZE = 36
+        const val ALIGNMENT = 64
+        const val KIND_TEXTURE = 0
+        const val KIND_SOUND = 1
+        const val FORMAT_RGBA8 = 0
+        const val FORMAT_RGB565 = 1
+        const val FORMAT_R8 = 2
+    }
+}
+
 android {
     namespace = "com.josephdunne.patplay"
     compileSdk = 34
@@ -17,6 +160,7 @@ android {
         externalNativeBuild {
             cmake {
                 arguments += "-DANDROID_STL=c++_shared"
+                arguments += "-DPAT_PLAY_VERSION_CODE=$versionCode"
             }
         }
     }
@@ -43,6 +187,40 @@ android {
             version = "3.22.1"
         }
     }
+    androidResources {
+        // The bundle and sound files are mapped directly, which only works if they're stored uncompressed.
+        noCompress += listOf("pak", "wav")
+    }
+}
+
+val packAssets = tasks.register<PackAssetsTask>("packAssets") {
+    assetsDirectory.set(layout.projectDirectory.dir("src/main/assets"))
+    textures.set(mapOf(
+        "jpg/pat.jpeg" to 1,
+        "jpg/springpat.jpeg" to 1,
+        "jpg/background.jpeg" to 0,
+        "png/zero.png" to 2,
+        "png/one.png" to 2,
+        "png/two.png" to 2,
+        "png/three.png" to 2,
+        "png/four.png" to 2,
+        "png/five.png" to 2,
+        "png/six.png" to 2,
+        "png/seven.png" to 2,
+        "png/eight.png" to 2,
+        "png/nine.png" to 2
+    ))
+    // Every file in the sound manifest, the path being the last field of each line.
+    sounds.set(layout.projectDirectory.file("src/main/assets/sounds.txt").asFile.readLines()
+        .map { it.substringBefore('#').trim() }
+        .filter { it.isNotEmpty() }
+        .map { it.split(Regex("\\s+")).last() })
+}
+
+androidComponents {
+    onVariants { variant ->
+        variant.sources.assets?.addGeneratedSourceDirectory(packAssets, PackAssetsTask::outputDirectory)
+    }
 }
 
 dependencies {
@@ -0,0 +1,89 @@
+#include "AssetBundle.h"
+
+#include <cstring>
+
+#include "AndroidOut.h"
+#include "TextureAsset.h"
+
+static constexpr uint32_t kBundleVersion = 1;
+static constexpr size_t kHeaderSize = 16;
+
+bool AssetBundle::open(AAssetManager *assetManager, const char *assetPath) {
+
+    close();
+
+    // One open for everything. The bundle isn't compressed, so this is a mapping rather than a copy.
+    auto asset = AAssetManager_open(assetManager, assetPath, AASSET_MODE_BUFFER);
+    if (!asset) {
+        aout << "No asset bundle at " << assetPath << std::endl;
+        return false;
+    }
+
+    auto data = static_cast<const uint8_t *>(AAsset_getBuffer(asset));
+    auto size = (size_t) AAsset_getLength(asset);
+    if (!data || size < kHeaderSize || memcmp(data, "PPAK", 4) != 0) {
+        aout << "Invalid asset bundle " << assetPath << std::endl;
+        AAsset_close(asset);
+        return false;
+    }
+
+    uint32_t version;
+    uint32_t entryCount;
+    memcpy(&version, data + 4, sizeof(version));
+    memcpy(&entryCount, data + 8, sizeof(entryCount));
+    if (version != kBundleVersion || kHeaderSize + (size_t) entryCount * sizeof(BundleEntry) > size) {
+        aout << "Unsupported asset bundle " << assetPath << " version " << version << std::endl;
+        AAsset_close(asset);
+        return false;
+    }
+
+    // Check every entry up front, so lookups can trust offsets and sizes. Textures are uploaded
+    // straight from the mapping, so their pixels have to all be there too.
+    auto entries = reinterpret_cast<const BundleEntry *>(data + kHeaderSize);
+    for (uint32_t i = 0; i < entryCount; i++) {
+        auto &entry = entries[i];
+        auto valid = (size_t) entry.offset + entry.size <= size;
+        if (valid && entry.kind == BundleEntryKind::Texture) {
+            auto bytesPerPixel = getBytesPerPixel((TextureFormat) entry.format);
+            valid = bytesPerPixel > 0
+                    && entry.width > 0 && entry.width <= INT32_MAX
+                    && entry.height > 0 && entry.height <= INT32_MAX
+                    && (uint64_t) entry.width * entry.height * bytesPerPixel <= entry.size;
+        }
+        if (!valid) {
+            aout << "Corrupt asset bundle entry " << i << " in " << assetPath << std::endl;
+            AAsset_close(asset);
+            return false;
+        }
+    }
+
+    asset_ = asset;
+    data_ = data;
+    size_ = size;
+    entries_ = entries;
+    entryCount_ = entryCount;
+
+    return true;
+
+}
+
+void AssetBundle::close() {
+    if (asset_) {
+        AAsset_close(asset_);
+    }
+    asset_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+    entries_ = nullptr;
+    entryCount_ = 0;
+}
+
+const BundleEntry *AssetBundle::find(const std::string &name, BundleEntryKind kind) const {
+    for (uint32_t i = 0; i < entryCount_; i++) {
+        auto &entry = entries_[i];
+        if (entry.kind == kind && strncmp(entry.name, name.c_str(), sizeof(entry.name)) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,84 @@
+#ifndef PAT_PLAY_ASSETBUNDLE_H
+#define PAT_PLAY_ASSETBUNDLE_H
+
+#include <cstdint>
+#include <string>
+
+#include <android/asset_manager.h>
+
+/*!
+ * The kinds of data stored in a bundle.
+ */
+enum class BundleEntryKind : uint32_t {
+    Texture = 0,
+    Sound = 1,
+};
+
+/*!
+ * One table of contents entry, as laid out in the bundle file.
+ *
+ * Textures hold tightly packed pixels in @a format (a TextureFormat), already keyed using
+ * @a mode (the removeWhiteOrBlack value TextureAsset::loadAsset would have used).
+ * Sounds hold interleaved signed 16-bit PCM, with @a width channels at a rate of @a height.
+ */
+struct BundleEntry {
+    char name[36];
+    BundleEntryKind kind;
+    uint32_t mode;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset;
+    uint32_t size;
+};
+
+static_assert(sizeof(BundleEntry) == 64, "BundleEntry must match the packer's layout");
+
+/*!
+ * Read only view of the packed asset bundle produced at build time by the packAssets task in
+ * app/build.gradle.kts.
+ *
+ * The bundle is stored uncompressed in the APK, so opening it with AASSET_MODE_BUFFER maps it
+ * straight into memory. Everything handed out points into that mapping and stays valid until the
+ * bundle is closed.
+ *
+ * Layout: a 16 byte header ("PPAK", version, entry count, reserved), the table of contents, then
+ * each entry's data aligned to 64 bytes. All values are little endian.
+ */
+class AssetBundle {
+public:
+    inline AssetBundle(): asset_(nullptr), data_(nullptr), size_(0), entries_(nullptr), entryCount_(0) {}
+
+    inline ~AssetBundle() {
+        close();
+    }
+
+    /*!
+     * Opens and validates a bundle.
+     * @return true if the bundle can be used
+     */
+    bool open(AAssetManager *assetManager, const char *assetPath);
+
+    void close();
+
+    inline bool isOpen() const { return data_ != nullptr; }
+
+    /*!
+     * @return the entry with the given name and kind, or null if there isn't one
+     */
+    const BundleEntry *find(const std::string &name, BundleEntryKind kind) const;
+
+    /*!
+     * @return a pointer to the entry's data inside the mapping
+     */
+    inline const uint8_t *getData(const BundleEntry &entry) const { return data_ + entry.offset; }
+
+private:
+    AAsset *asset_;
+    const uint8_t *data_;
+    size_t size_;
+    const BundleEntry *entries_;
+    uint32_t entryCount_;
+};
+
+#endif //PAT_PLAY_ASSETBUNDLE_H
@@ -48,6 +48,20 @@
 #include <algorithm>
 #include <limits>
 
+// the bulk sample conversions use vector instructions where they're available. NEON needs
+// AArch64 for its double precision lanes, which keep the results the same as the scalar code
+#if defined (__ARM_NEON) && defined (__aarch64__)
+#include <arm_neon.h>
+#define AUDIOFILE_NEON 1
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#define AUDIOFILE_SSE2 1
+#if defined (__SSSE3__)
+#include <tmmintrin.h>
+#define AUDIOFILE_SSSE3 1
+#endif
+#endif
+
 // disable some warnings on Windows
 #if defined (_MSC_VER)
 __pragma(warning (push))
@@ -86,6 +100,26 @@ enum class AudioFileFormat
     Aiff
 };
 
+//=============================================================
+/** A read-only view of an encoded audio file somewhere in memory,
+ * such as a mapped asset or file. Nothing is copied, so the bytes
+ * must stay valid until loading has finished.
+ */
+struct AudioFileData
+{
+    AudioFileData (const uint8_t* fileBytes, size_t fileLength) : bytes (fileBytes), length (fileLength) {}
+    AudioFileData (const std::vector<uint8_t>& fileData) : bytes (fileData.data()), length (fileData.size()) {}
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    const uint8_t* begin() const { return bytes; }
+    const uint8_t* end() const { return bytes + length; }
+    const uint8_t& operator[] (size_t i) const { return bytes[i]; }
+
+    const uint8_t* bytes;
+    size_t length;
+};
+
 //=============================================================
 template <class T>
 class AudioFile
@@ -117,6 +151,12 @@ public:
     /** Loads an audio file from data in memory */
     bool loadFromMemory (std::vector<uint8_t>& fileData);
 
+    /** Loads an audio file from bytes in memory, decoding them in place
+     * without taking a copy.
+     * @Returns true if the file was successfully loaded
+     */
+    bool loadFromMemory (const uint8_t* bytes, size_t numBytes);
+
     //=============================================================
     /** @Returns the sample rate */
     uint32_t getSampleRate() const;
@@ -195,9 +235,23 @@ private:
     };
 
     //=============================================================
-    AudioFileFormat determineAudioFileFormat (std::vector<uint8_t>& fileData);
-    bool decodeWaveFile (std::vector<uint8_t>& fileData);
-    bool decodeAiffFile (std::vector<uint8_t>& fileData);
+    AudioFileFormat determineAudioFileFormat (AudioFileData fileData);
+    bool decodeWaveFile (AudioFileData fileData);
+    bool decodeAiffFile (AudioFileData fileData);
+
+    //=============================================================
+    /** Decodes interleaved sample data into the already sized buffer.
+     * The format is checked once here, then the whole buffer goes
+     * through a bulk conversion specialised for it.
+     */
+    template <bool BigEndian>
+    void decodeSampleData (const uint8_t* source, int numSamplesPerChannel, int numChannels, bool isFloat);
+
+    /** Encodes the buffer as interleaved sample data in the current
+     * bit depth, the reverse of decodeSampleData.
+     */
+    template <bool BigEndian>
+    bool encodeSampleData (uint8_t* destination, bool isFloat);
 
     //=============================================================
     bool saveToWaveFile (std::string filePath);
@@ -207,14 +261,14 @@ private:
     void clearAudioBuffer();
 
     //=============================================================
-    int32_t fourBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness = Endianness::LittleEndian);
-    int16_t twoBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness = Endianness::LittleEndian);
-    int getIndexOfString (std::vector<uint8_t>& source, std::string s);
-    int getIndexOfChunk (std::vector<uint8_t>& source, const std::string& chunkHeaderID, int startIndex, Endianness endianness = Endianness::LittleEndian);
+    int32_t fourBytesToInt (AudioFileData source, int startIndex, Endianness endianness = Endianness::LittleEndian);
+    int16_t twoBytesToInt (AudioFileData source, int startIndex, Endianness endianness = Endianness::LittleEndian);
+    int getIndexOfString (AudioFileData source, std::string s);
+    int getIndexOfChunk (AudioFileData source, const std::string& chunkHeaderID, int startIndex, Endianness endianness = Endianness::LittleEndian);
 
     //=============================================================
-    uint32_t getAiffSampleRate (std::vector<uint8_t>& fileData, int sampleRateStartIndex);
-    bool tenByteMatch (std::vector<uint8_t>& v1, int startIndex1, std::vector<uint8_t>& v2, int startIndex2);
+    uint32_t getAiffSampleRate (AudioFileData fileData, int sampleRateStartIndex);
+    bool tenByteMatch (AudioFileData v1, int startIndex1, AudioFileData v2, int startIndex2);
     void addSampleRateToAiffData (std::vector<uint8_t>& fileData, uint32_t sampleRate);
 
     //=============================================================
@@ -274,9 +328,60 @@ struct AudioSampleConverter
     /** Convert a an audio sample to a 32-bit signed integer */
     static int32_t sampleToThirtyTwoBitInt (T sample);
 
+    //=============================================================
+    /** Convert one sample stored in a file to an audio sample. 8-bit samples
+     * are unsigned in little endian (WAV) files and signed in big endian
+     * (AIFF) ones, and IsFloat reads 32-bit samples as IEEE floats
+     */
+    template <int BitDepth, bool BigEndian, bool IsFloat>
+    static T bytesToSample (const uint8_t* source);
+
+    /** Convert an audio sample to the way it is stored in a file */
+    template <int BitDepth, bool BigEndian, bool IsFloat>
+    static void sampleToBytes (T sample, uint8_t* destination);
+
+    //=============================================================
+    /** Convert a run of samples stored in a file to audio samples, keeping
+     * their order. For float samples this uses NEON or SSE, and gives
+     * exactly the same results as converting them one at a time
+     */
+    template <int BitDepth, bool BigEndian, bool IsFloat>
+    static void bytesToSamples (const uint8_t* source, T* destination, size_t numSamples);
+
+    /** Convert interleaved frames stored in a file to one array of audio
+     * samples per channel
+     */
+    template <int BitDepth, bool BigEndian, bool IsFloat>
+    static void interleavedBytesToSamples (const uint8_t* source, T* const* destinations, size_t numFrames, int numChannels);
+
+    /** Convert a run of audio samples to the way they are stored in a file,
+     * the reverse of bytesToSamples
+     */
+    template <int BitDepth, bool BigEndian, bool IsFloat>
+    static void samplesToBytes (const T* source, uint8_t* destination, size_t numSamples);
+
+    /** Convert one array of audio samples per channel to interleaved frames
+     * stored in a file
+     */
+    template <int BitDepth, bool BigEndian, bool IsFloat>
+    static void samplesToInterleavedBytes (const T* const* sources, uint8_t* destination, size_t numFrames, int numChannels);
+
     //=============================================================
     /** Helper clamp function to enforce ranges */
     static T clamp (T v1, T minValue, T maxValue);
+
+private:
+    //=============================================================
+    /** The vector parts of the conversions for float samples. They work
+     * on either one array of samples, or two for the channels of stereo
+     * frames, and return how many samples they converted, leaving the
+     * rest to the scalar code
+     */
+    template <int BitDepth, bool BigEndian, bool IsFloat, bool Stereo>
+    static size_t bytesToFloatsVectorised (const uint8_t* source, float* const* destinations, size_t numSamples);
+
+    template <int BitDepth, bool BigEndian, bool IsFloat, bool Stereo>
+    static size_t floatsToBytesVectorised (const float* const* sources, uint8_t* destination, size_t numSamples);
 };
 
 //=============================================================
@@ -557,6 +662,23 @@ bool AudioFile<T>::load (std::string filePath)
 template <class T>
 bool AudioFile<T>::loadFromMemory (std::vector<uint8_t>& fileData)
 {
+    return loadFromMemory (fileData.data(), fileData.size());
+}
+
+//=============================================================
+template <class T>
+bool AudioFile<T>::loadFromMemory (const uint8_t* bytes, size_t numBytes)
+{
+    // Handle very small files that will break our attempt to read the
+    // first header info from them
+    if (bytes == nullptr || numBytes < 12)
+    {
+        reportError ("ERROR: File is not a valid audio file");
+        return false;
+    }
+
+    AudioFileData fileData (bytes, numBytes);
+
     // get audio file format
     audioFileFormat = determineAudioFileFormat (fileData);
 
@@ -577,7 +699,7 @@ bool AudioFile<T>::loadFromMemory (std::vector<uint8_t>& fileData)
 
 //=============================================================
 template <class T>
-bool AudioFile<T>::decodeWaveFile (std::vector<uint8_t>& fileData)
+bool AudioFile<T>::decodeWaveFile (AudioFileData fileData)
 {
     // -----------------------------------------------------------
     // HEADER CHUNK
@@ -661,67 +783,21 @@ bool AudioFile<T>::decodeWaveFile (std::vector<uint8_t>& fileData)
     int numSamples = dataChunkSize / (numChannels * bitDepth / 8);
     int samplesStartIndex = indexOfDataChunk + 8;
 
-    clearAudioBuffer();
-    samples.resize (numChannels);
-
-    for (int i = 0; i < numSamples; i++)
+    // check the data chunk is all there once, rather than for every sample
+    if (numSamples < 0 || samplesStartIndex + static_cast<size_t> (numSamples) * numBytesPerBlock > fileData.size())
     {
-        for (int channel = 0; channel < numChannels; channel++)
-        {
-            int sampleIndex = samplesStartIndex + (numBytesPerBlock * i) + channel * numBytesPerSample;
-
-            if ((sampleIndex + (bitDepth / 8) - 1) >= fileData.size())
-            {
-                reportError ("ERROR: read file error as the metadata indicates more samples than there are in the file data");
-                return false;
-            }
-
-            if (bitDepth == 8)
-            {
-                T sample = AudioSampleConverter<T>::unsignedByteToSample (fileData[sampleIndex]);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = twoBytesToInt (fileData, sampleIndex);
-                T sample = AudioSampleConverter<T>::sixteenBitIntToSample (sampleAsInt);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsInt = 0;
-                sampleAsInt = (fileData[sampleIndex + 2] << 16) | (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex];
+        reportError ("ERROR: read file error as the metadata indicates more samples than there are in the file data");
+        return false;
+    }
 
-                if (sampleAsInt & 0x800000) //  if the 24th bit is set, this is a negative number in 24-bit world
-                    sampleAsInt = sampleAsInt | ~0xFFFFFF; // so make sure sign is extended to the 32 bit float
+    clearAudioBuffer();
+    samples.resize (numChannels);
 
-                T sample = AudioSampleConverter<T>::twentyFourBitIntToSample (sampleAsInt);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 32)
-            {
-                int32_t sampleAsInt = fourBytesToInt (fileData, sampleIndex);
-                T sample;
+    for (auto& channelSamples : samples)
+        channelSamples.resize (numSamples);
 
-                if (audioFormat == WavAudioFormat::IEEEFloat && is_floating_point_v<T>)
-                {
-                    float f;
-                    memcpy (&f, &sampleAsInt, sizeof(int32_t));
-                    sample = (T)f;
-                }
-                else // assume PCM
-                {
-                    sample = AudioSampleConverter<T>::thirtyTwoBitIntToSample (sampleAsInt);
-                }
-
-                samples[channel].push_back (sample);
-            }
-            else
-            {
-                assert (false);
-            }
-        }
-    }
+    bool isFloat = audioFormat == WavAudioFormat::IEEEFloat && is_floating_point_v<T>;
+    decodeSampleData<false> (fileData.data() + samplesStartIndex, numSamples, numChannels, isFloat);
 
     // -----------------------------------------------------------
     // iXML CHUNK
@@ -736,7 +812,7 @@ bool AudioFile<T>::decodeWaveFile (std::vector<uint8_t>& fileData)
 
 //=============================================================
 template <class T>
-bool AudioFile<T>::decodeAiffFile (std::vector<uint8_t>& fileData)
+bool AudioFile<T>::decodeAiffFile (AudioFileData fileData)
 {
     // -----------------------------------------------------------
     // HEADER CHUNK
@@ -815,8 +891,9 @@ bool AudioFile<T>::decodeAiffFile (std::vector<uint8_t>& fileData)
     int totalNumAudioSampleBytes = numSamplesPerChannel * numBytesPerFrame;
     int samplesStartIndex = s + 16 + (int)offset;
 
-    // sanity check the data
-    if ((soundDataChunkSize - 8) != totalNumAudioSampleBytes || totalNumAudioSampleBytes > static_cast<long>(fileData.size() - samplesStartIndex))
+    // sanity check the data, which also makes sure every sample is in the file data
+    if (numSamplesPerChannel < 0 || samplesStartIndex < 0 || static_cast<size_t> (samplesStartIndex) > fileData.size()
+        || (soundDataChunkSize - 8) != totalNumAudioSampleBytes || totalNumAudioSampleBytes > static_cast<long>(fileData.size() - samplesStartIndex))
     {
         reportError ("ERROR: the metadatafor this file doesn't seem right");
         return false;
@@ -825,58 +902,10 @@ bool AudioFile<T>::decodeAiffFile (std::vector<uint8_t>& fileData)
     clearAudioBuffer();
     samples.resize (numChannels);
 
-    for (int i = 0; i < numSamplesPerChannel; i++)
-    {
-        for (int channel = 0; channel < numChannels; channel++)
-        {
-            int sampleIndex = samplesStartIndex + (numBytesPerFrame * i) + channel * numBytesPerSample;
-
-            if ((sampleIndex + (bitDepth / 8) - 1) >= fileData.size())
-            {
-                reportError ("ERROR: read file error as the metadata indicates more samples than there are in the file data");
-                return false;
-            }
-
-            if (bitDepth == 8)
-            {
-                T sample = AudioSampleConverter<T>::signedByteToSample (static_cast<int8_t> (fileData[sampleIndex]));
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = twoBytesToInt (fileData, sampleIndex, Endianness::BigEndian);
-                T sample = AudioSampleConverter<T>::sixteenBitIntToSample (sampleAsInt);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsInt = 0;
-                sampleAsInt = (fileData[sampleIndex] << 16) | (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex + 2];
-
-                if (sampleAsInt & 0x800000) //  if the 24th bit is set, this is a negative number in 24-bit world
-                    sampleAsInt = sampleAsInt | ~0xFFFFFF; // so make sure sign is extended to the 32 bit float
-
-                T sample = AudioSampleConverter<T>::twentyFourBitIntToSample (sampleAsInt);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 32)
-            {
-                int32_t sampleAsInt = fourBytesToInt (fileData, sampleIndex, Endianness::BigEndian);
-                T sample;
+    for (auto& channelSamples : samples)
+        channelSamples.resize (numSamplesPerChannel);
 
-                if (audioFormat == AIFFAudioFormat::Compressed)
-                    sample = (T)reinterpret_cast<float&> (sampleAsInt);
-                else // assume PCM
-                    sample = AudioSampleConverter<T>::thirtyTwoBitIntToSample (sampleAsInt);
-
-                samples[channel].push_back (sample);
-            }
-            else
-            {
-                assert (false);
-            }
-        }
-    }
+    decodeSampleData<true> (fileData.data() + samplesStartIndex, numSamplesPerChannel, numChannels, audioFormat == AIFFAudioFormat::Compressed);
 
     // -----------------------------------------------------------
     // iXML CHUNK
@@ -891,7 +920,64 @@ bool AudioFile<T>::decodeAiffFile (std::vector<uint8_t>& fileData)
 
 //=============================================================
 template <class T>
-uint32_t AudioFile<T>::getAiffSampleRate (std::vector<uint8_t>& fileData, int sampleRateStartIndex)
+template <bool BigEndian>
+void AudioFile<T>::decodeSampleData (const uint8_t* source, int numSamplesPerChannel, int numChannels, bool isFloat)
+{
+    std::vector<T*> destinations (numChannels);
+
+    for (int channel = 0; channel < numChannels; channel++)
+        destinations[channel] = samples[channel].data();
+
+    size_t numFrames = static_cast<size_t> (numSamplesPerChannel);
+
+    if (bitDepth == 8)
+        AudioSampleConverter<T>::template interleavedBytesToSamples<8, BigEndian, false> (source, destinations.data(), numFrames, numChannels);
+    else if (bitDepth == 16)
+        AudioSampleConverter<T>::template interleavedBytesToSamples<16, BigEndian, false> (source, destinations.data(), numFrames, numChannels);
+    else if (bitDepth == 24)
+        AudioSampleConverter<T>::template interleavedBytesToSamples<24, BigEndian, false> (source, destinations.data(), numFrames, numChannels);
+    else if (bitDepth == 32 && isFloat)
+        AudioSampleConverter<T>::template interleavedBytesToSamples<32, BigEndian, true> (source, destinations.data(), numFrames, numChannels);
+    else if (bitDepth == 32)
+        AudioSampleConverter<T>::template interleavedBytesToSamples<32, BigEndian, false> (source, destinations.data(), numFrames, numChannels);
+    else
+        assert (false);
+}
+
+//=============================================================
+template <class T>
+template <bool BigEndian>
+bool AudioFile<T>::encodeSampleData (uint8_t* destination, bool isFloat)
+{
+    std::vector<const T*> sources (getNumChannels());
+
+    for (int channel = 0; channel < getNumChannels(); channel++)
+        sources[channel] = samples[channel].data();
+
+    size_t numFrames = static_cast<size_t> (getNumSamplesPerChannel());
+
+    if (bitDepth == 8)
+        AudioSampleConverter<T>::template samplesToInterleavedBytes<8, BigEndian, false> (sources.data(), destination, numFrames, getNumChannels());
+    else if (bitDepth == 16)
+        AudioSampleConverter<T>::template samplesToInterleavedBytes<16, BigEndian, false> (sources.data(), destination, numFrames, getNumChannels());
+    else if (bitDepth == 24)
+        AudioSampleConverter<T>::template samplesToInterleavedBytes<24, BigEndian, false> (sources.data(), destination, numFrames, getNumChannels());
+    else if (bitDepth == 32 && isFloat)
+        AudioSampleConverter<T>::template samplesToInterleavedBytes<32, BigEndian, true> (sources.data(), destination, numFrames, getNumChannels());
+    else if (bitDepth == 32)
+        AudioSampleConverter<T>::template samplesToInterleavedBytes<32, BigEndian, false> (sources.data(), destination, numFrames, getNumChannels());
+    else
+    {
+        assert (false && "Trying to write a file with unsupported bit depth");
+        return false;
+    }
+
+    return true;
+}
+
+//=============================================================
+template <class T>
+uint32_t AudioFile<T>::getAiffSampleRate (AudioFileData fileData, int sampleRateStartIndex)
 {
     for (auto it : aiffSampleRateTable)
     {
@@ -904,7 +990,7 @@ uint32_t AudioFile<T>::getAiffSampleRate (std::vector<uint8_t>& fileData, int sa
 
 //=============================================================
 template <class T>
-bool AudioFile<T>::tenByteMatch (std::vector<uint8_t>& v1, int startIndex1, std::vector<uint8_t>& v2, int startIndex2)
+bool AudioFile<T>::tenByteMatch (AudioFileData v1, int startIndex1, AudioFileData v2, int startIndex2)
 {
     for (int i = 0; i < 10; i++)
     {
@@ -993,51 +1079,11 @@ bool AudioFile<T>::saveToWaveFile (std::string filePath)
     addStringToFileData (fileData, "data");
     addInt32ToFileData (fileData, dataChunkSize);
 
-    for (int i = 0; i < getNumSamplesPerChannel(); i++)
-    {
-        for (int channel = 0; channel < getNumChannels(); channel++)
-        {
-            if (bitDepth == 8)
-            {
-                uint8_t byte = AudioSampleConverter<T>::sampleToUnsignedByte (samples[channel][i]);
-                fileData.push_back (byte);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = AudioSampleConverter<T>::sampleToSixteenBitInt (samples[channel][i]);
-                addInt16ToFileData (fileData, sampleAsInt);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsIntAgain = AudioSampleConverter<T>::sampleToTwentyFourBitInt (samples[channel][i]);
+    size_t dataChunkStart = fileData.size();
+    fileData.resize (dataChunkStart + dataChunkSize);
 
-                uint8_t bytes[3];
-                bytes[2] = (uint8_t) (sampleAsIntAgain >> 16) & 0xFF;
-                bytes[1] = (uint8_t) (sampleAsIntAgain >>  8) & 0xFF;
-                bytes[0] = (uint8_t) sampleAsIntAgain & 0xFF;
-
-                fileData.push_back (bytes[0]);
-                fileData.push_back (bytes[1]);
-                fileData.push_back (bytes[2]);
-            }
-            else if (bitDepth == 32)
-            {
-                int32_t sampleAsInt;
-
-                if (audioFormat == WavAudioFormat::IEEEFloat)
-                    sampleAsInt = (int32_t) reinterpret_cast<int32_t&> (samples[channel][i]);
-                else // assume PCM
-                sampleAsInt = AudioSampleConverter<T>::sampleToThirtyTwoBitInt (samples[channel][i]);
-
-                addInt32ToFileData (fileData, sampleAsInt, Endianness::LittleEndian);
-            }
-            else
-            {
-                assert (false && "Trying to write a file with unsupported bit depth");
-                return false;
-            }
-        }
-    }
+    if (! encodeSampleData<false> (fileData.data() + dataChunkStart, audioFormat == WavAudioFormat::IEEEFloat))
+        return false;
 
     // -----------------------------------------------------------
     // iXML CHUNK
@@ -1103,46 +1149,12 @@ bool AudioFile<T>::saveToAiffFile (std::string filePath)
     addInt32ToFileData (fileData, 0, Endianness::BigEndian); // offset
     addInt32ToFileData (fileData, 0, Endianness::BigEndian); // block size
 
-    for (int i = 0; i < getNumSamplesPerChannel(); i++)
-    {
-        for (int channel = 0; channel < getNumChannels(); channel++)
-        {
-            if (bitDepth == 8)
-            {
-                uint8_t byte = static_cast<uint8_t> (AudioSampleConverter<T>::sampleToSignedByte (samples[channel][i]));
-                fileData.push_back (byte);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = AudioSampleConverter<T>::sampleToSixteenBitInt (samples[channel][i]);
-                addInt16ToFileData (fileData, sampleAsInt, Endianness::BigEndian);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsIntAgain = AudioSampleConverter<T>::sampleToTwentyFourBitInt (samples[channel][i]);
-
-                uint8_t bytes[3];
-                bytes[0] = (uint8_t) (sampleAsIntAgain >> 16) & 0xFF;
-                bytes[1] = (uint8_t) (sampleAsIntAgain >>  8) & 0xFF;
-                bytes[2] = (uint8_t) sampleAsIntAgain & 0xFF;
+    // write samples as signed integers (no implementation yet for floating point, but looking at WAV implementation should help)
+    size_t soundDataStart = fileData.size();
+    fileData.resize (soundDataStart + totalNumAudioSampleBytes);
 
-                fileData.push_back (bytes[0]);
-                fileData.push_back (bytes[1]);
-                fileData.push_back (bytes[2]);
-            }
-            else if (bitDepth == 32)
-            {
-                // write samples as signed integers (no implementation yet for floating point, but looking at WAV implementation should help)
-                int32_t sampleAsInt = AudioSampleConverter<T>::sampleToThirtyTwoBitInt (samples[channel][i]);
-                addInt32ToFileData (fileData, sampleAsInt, Endianness::BigEndian);
-            }
-            else
-            {
-                assert (false && "Trying to write a file with unsupported bit depth");
-                return false;
-            }
-        }
-    }
+    if (! encodeSampleData<true> (fileData.data() + soundDataStart, false))
+        return false;
 
     // -----------------------------------------------------------
     // iXML CHUNK
@@ -1172,12 +1184,7 @@ bool AudioFile<T>::writeDataToFile (std::vector<uint8_t>& fileData, std::string
 
     if (outputFile.is_open())
     {
-        for (size_t i = 0; i < fileData.size(); i++)
-        {
-            char value = (char) fileData[i];
-            outputFile.write (&value, sizeof (char));
-        }
-
+        outputFile.write (reinterpret_cast<const char*> (fileData.data()), static_cast<std::streamsize> (fileData.size()));
         outputFile.close();
 
         return true;
@@ -1254,7 +1261,7 @@ void AudioFile<T>::clearAudioBuffer()
 
 //=============================================================
 template <class T>
-AudioFileFormat AudioFile<T>::determineAudioFileFormat (std::vector<uint8_t>& fileData)
+AudioFileFormat AudioFile<T>::determineAudioFileFormat (AudioFileData fileData)
 {
     std::string header (fileData.begin(), fileData.begin() + 4);
 
@@ -1268,7 +1275,7 @@ AudioFileFormat AudioFile<T>::determineAudioFileFormat (std::vector<uint8_t>& fi
 
 //=============================================================
 template <class T>
-int32_t AudioFile<T>::fourBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness)
+int32_t AudioFile<T>::fourBytesToInt (AudioFileData source, int startIndex, Endianness endianness)
 {
     if (source.size() >= (startIndex + 4))
     {
@@ -1290,7 +1297,7 @@ int32_t AudioFile<T>::fourBytesToInt (std::vector<uint8_t>& source, int startInd
 
 //=============================================================
 template <class T>
-int16_t AudioFile<T>::twoBytesToInt (std::vector<uint8_t>& source, int startIndex, Endianness endianness)
+int16_t AudioFile<T>::twoBytesToInt (AudioFileData source, int startIndex, Endianness endianness)
 {
     int16_t result;
 
@@ -1304,7 +1311,7 @@ int16_t AudioFile<T>::twoBytesToInt (std::vector<uint8_t>& source, int startInde
 
 //=============================================================
 template <class T>
-int AudioFile<T>::getIndexOfString (std::vector<uint8_t>& source, std::string stringToSearchFor)
+int AudioFile<T>::getIndexOfString (AudioFileData source, std::string stringToSearchFor)
 {
     int index = -1;
     int stringLength = (int)stringToSearchFor.length();
@@ -1325,7 +1332,7 @@ int AudioFile<T>::getIndexOfString (std::vector<uint8_t>& source, std::string st
 
 //=============================================================
 template <class T>
-int AudioFile<T>::getIndexOfChunk (std::vector<uint8_t>& source, const std::string& chunkHeaderID, int startIndex, Endianness endianness)
+int AudioFile<T>::getIndexOfChunk (AudioFileData source, const std::string& chunkHeaderID, int startIndex, Endianness endianness)
 {
     constexpr int dataLen = 4;
 
@@ -1579,6 +1586,538 @@ T AudioSampleConverter<T>::signedByteToSample (int8_t sample)
     }
 }
 
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat>
+T AudioSampleConverter<T>::bytesToSample (const uint8_t* source)
+{
+    if constexpr (BitDepth == 8)
+    {
+        // WAV stores 8-bit samples unsigned, and AIFF stores them signed
+        if constexpr (BigEndian)
+            return signedByteToSample (static_cast<int8_t> (source[0]));
+        else
+            return unsignedByteToSample (source[0]);
+    }
+    else if constexpr (BitDepth == 16)
+    {
+        int16_t sampleAsInt = BigEndian ? static_cast<int16_t> ((source[0] << 8) | source[1]) : static_cast<int16_t> ((source[1] << 8) | source[0]);
+        return sixteenBitIntToSample (sampleAsInt);
+    }
+    else if constexpr (BitDepth == 24)
+    {
+        int32_t sampleAsInt = BigEndian ? (source[0] << 16) | (source[1] << 8) | source[2] : (source[2] << 16) | (source[1] << 8) | source[0];
+
+        if (sampleAsInt & 0x800000) //  if the 24th bit is set, this is a negative number in 24-bit world
+            sampleAsInt = sampleAsInt | ~0xFFFFFF; // so make sure sign is extended to the 32 bit float
+
+        return twentyFourBitIntToSample (sampleAsInt);
+    }
+    else
+    {
+        uint32_t bits = BigEndian
+                ? (static_cast<uint32_t> (source[0]) << 24) | (source[1] << 16) | (source[2] << 8) | source[3]
+                : (static_cast<uint32_t> (source[3]) << 24) | (source[2] << 16) | (source[1] << 8) | source[0];
+
+        if constexpr (IsFloat)
+        {
+            float f;
+            memcpy (&f, &bits, sizeof (float));
+            return (T)f;
+        }
+        else
+        {
+            return thirtyTwoBitIntToSample (static_cast<int32_t> (bits));
+        }
+    }
+}
+
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat>
+void AudioSampleConverter<T>::sampleToBytes (T sample, uint8_t* destination)
+{
+    uint32_t bits;
+
+    if constexpr (BitDepth == 8)
+    {
+        // WAV stores 8-bit samples unsigned, and AIFF stores them signed
+        if constexpr (BigEndian)
+            destination[0] = static_cast<uint8_t> (sampleToSignedByte (sample));
+        else
+            destination[0] = sampleToUnsignedByte (sample);
+
+        return;
+    }
+    else if constexpr (BitDepth == 16)
+    {
+        bits = static_cast<uint16_t> (sampleToSixteenBitInt (sample));
+    }
+    else if constexpr (BitDepth == 24)
+    {
+        bits = static_cast<uint32_t> (sampleToTwentyFourBitInt (sample));
+    }
+    else if constexpr (IsFloat)
+    {
+        float f = (float)sample;
+        memcpy (&bits, &f, sizeof (float));
+    }
+    else
+    {
+        bits = static_cast<uint32_t> (sampleToThirtyTwoBitInt (sample));
+    }
+
+    constexpr int numBytes = BitDepth / 8;
+
+    for (int i = 0; i < numBytes; i++)
+        destination[BigEndian ? numBytes - 1 - i : i] = (uint8_t) (bits >> (8 * i)) & 0xFF;
+}
+
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat>
+void AudioSampleConverter<T>::bytesToSamples (const uint8_t* source, T* destination, size_t numSamples)
+{
+    constexpr int numBytesPerSample = BitDepth / 8;
+    size_t i = 0;
+
+    if constexpr (is_same_v<T, float>)
+        i = bytesToFloatsVectorised<BitDepth, BigEndian, IsFloat, false> (source, &destination, numSamples);
+
+    for (; i < numSamples; i++)
+        destination[i] = bytesToSample<BitDepth, BigEndian, IsFloat> (source + i * numBytesPerSample);
+}
+
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat>
+void AudioSampleConverter<T>::interleavedBytesToSamples (const uint8_t* source, T* const* destinations, size_t numFrames, int numChannels)
+{
+    constexpr int numBytesPerSample = BitDepth / 8;
+    const size_t numBytesPerFrame = static_cast<size_t> (numChannels) * numBytesPerSample;
+    size_t start = 0;
+
+    // mono needs no deinterleaving, and stereo float samples are split
+    // between the channels as they're converted
+    if (numChannels == 1)
+    {
+        bytesToSamples<BitDepth, BigEndian, IsFloat> (source, destinations[0], numFrames);
+        return;
+    }
+
+    if constexpr (is_same_v<T, float>)
+    {
+        if (numChannels == 2)
+            start = bytesToFloatsVectorised<BitDepth, BigEndian, IsFloat, true> (source, destinations, numFrames * 2) / 2;
+    }
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        T* destination = destinations[channel];
+        const uint8_t* sample = source + start * numBytesPerFrame + channel * numBytesPerSample;
+
+        for (size_t i = start; i < numFrames; i++, sample += numBytesPerFrame)
+            destination[i] = bytesToSample<BitDepth, BigEndian, IsFloat> (sample);
+    }
+}
+
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat>
+void AudioSampleConverter<T>::samplesToBytes (const T* source, uint8_t* destination, size_t numSamples)
+{
+    constexpr int numBytesPerSample = BitDepth / 8;
+    size_t i = 0;
+
+    if constexpr (is_same_v<T, float>)
+        i = floatsToBytesVectorised<BitDepth, BigEndian, IsFloat, false> (&source, destination, numSamples);
+
+    for (; i < numSamples; i++)
+        sampleToBytes<BitDepth, BigEndian, IsFloat> (source[i], destination + i * numBytesPerSample);
+}
+
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat>
+void AudioSampleConverter<T>::samplesToInterleavedBytes (const T* const* sources, uint8_t* destination, size_t numFrames, int numChannels)
+{
+    constexpr int numBytesPerSample = BitDepth / 8;
+    const size_t numBytesPerFrame = static_cast<size_t> (numChannels) * numBytesPerSample;
+    size_t start = 0;
+
+    if (numChannels == 1)
+    {
+        samplesToBytes<BitDepth, BigEndian, IsFloat> (sources[0], destination, numFrames);
+        return;
+    }
+
+    if constexpr (is_same_v<T, float>)
+    {
+        if (numChannels == 2)
+            start = floatsToBytesVectorised<BitDepth, BigEndian, IsFloat, true> (sources, destination, numFrames * 2) / 2;
+    }
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        const T* source = sources[channel];
+        uint8_t* sample = destination + start * numBytesPerFrame + channel * numBytesPerSample;
+
+        for (size_t i = start; i < numFrames; i++, sample += numBytesPerFrame)
+            sampleToBytes<BitDepth, BigEndian, IsFloat> (source[i], sample);
+    }
+}
+
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat, bool Stereo>
+size_t AudioSampleConverter<T>::bytesToFloatsVectorised (const uint8_t* source, float* const* destinations, size_t numSamples)
+{
+    size_t i = 0;
+
+    // the scalar code divides by 2^n - 1, or by 2^31 for 32-bit samples.
+    // Division is slow, so instead each sample is multiplied by 2^-n and by
+    // what's left of the reciprocal, and the two are added. Every possible
+    // 8, 16 and 24-bit sample has been checked to come out exactly the same
+    // as dividing, with or without the multiply and add being fused.
+    // Dividing by 2^31 is exact as a multiply anyway
+#if defined (AUDIOFILE_NEON) || defined (AUDIOFILE_SSE2)
+    constexpr int shift = BitDepth == 32 ? 31 : BitDepth - 1;
+    const float high = 1.f / static_cast<float> (1LL << shift);
+    const float low = BitDepth == 32 ? 0.f : static_cast<float> (1. / static_cast<double> ((1LL << shift) - 1) - 1. / static_cast<double> (1LL << shift));
+#endif
+
+    // each loop converts 8 samples at a time, and every store splits them
+    // between the channels for stereo
+#if defined (AUDIOFILE_NEON)
+    const float32x4_t highScale = vdupq_n_f32 (high);
+    const float32x4_t lowScale = vdupq_n_f32 (low);
+
+    auto scale = [&] (int32x4_t x)
+    {
+        float32x4_t f = vcvtq_f32_s32 (x);
+        return vaddq_f32 (vmulq_f32 (f, highScale), vmulq_f32 (f, lowScale));
+    };
+
+    auto store = [&] (size_t index, float32x4_t first, float32x4_t second)
+    {
+        if constexpr (Stereo)
+        {
+            float32x4x2_t channels = vuzpq_f32 (first, second);
+            vst1q_f32 (destinations[0] + index / 2, channels.val[0]);
+            vst1q_f32 (destinations[1] + index / 2, channels.val[1]);
+        }
+        else
+        {
+            vst1q_f32 (destinations[0] + index, first);
+            vst1q_f32 (destinations[0] + index + 4, second);
+        }
+    };
+
+    if constexpr (BitDepth == 8)
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            uint8x8_t bytes = vld1_u8 (source + i);
+            int16x8_t wide = BigEndian ? vmovl_s8 (vreinterpret_s8_u8 (bytes))
+                                       : vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (bytes)), vdupq_n_s16 (128));
+            store (i, scale (vmovl_s16 (vget_low_s16 (wide))), scale (vmovl_s16 (vget_high_s16 (wide))));
+        }
+    }
+    else if constexpr (BitDepth == 16)
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            uint8x16_t bytes = vld1q_u8 (source + i * 2);
+
+            if constexpr (BigEndian)
+                bytes = vrev16q_u8 (bytes);
+
+            int16x8_t wide = vreinterpretq_s16_u8 (bytes);
+            store (i, scale (vmovl_s16 (vget_low_s16 (wide))), scale (vmovl_s16 (vget_high_s16 (wide))));
+        }
+    }
+    else if constexpr (BitDepth == 24)
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            // split the samples into a plane for each of their bytes, then put
+            // the top byte's sign in the top 16 bits of each 32-bit lane
+            uint8x8x3_t bytes = vld3_u8 (source + i * 3);
+            uint8x8_t low = bytes.val[BigEndian ? 2 : 0];
+            uint8x8_t high = bytes.val[BigEndian ? 0 : 2];
+            uint16x8_t lowWords = vorrq_u16 (vmovl_u8 (low), vshll_n_u8 (bytes.val[1], 8));
+            int16x8_t highWords = vmovl_s8 (vreinterpret_s8_u8 (high));
+            int32x4_t first = vorrq_s32 (vshll_n_s16 (vget_low_s16 (highWords), 16), vreinterpretq_s32_u32 (vmovl_u16 (vget_low_u16 (lowWords))));
+            int32x4_t second = vorrq_s32 (vshll_n_s16 (vget_high_s16 (highWords), 16), vreinterpretq_s32_u32 (vmovl_u16 (vget_high_u16 (lowWords))));
+            store (i, scale (first), scale (second));
+        }
+    }
+    else
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            uint8x16_t first = vld1q_u8 (source + i * 4);
+            uint8x16_t second = vld1q_u8 (source + i * 4 + 16);
+
+            if constexpr (BigEndian)
+            {
+                first = vrev32q_u8 (first);
+                second = vrev32q_u8 (second);
+            }
+
+            if constexpr (IsFloat)
+                store (i, vreinterpretq_f32_u8 (first), vreinterpretq_f32_u8 (second));
+            else
+                store (i, scale (vreinterpretq_s32_u8 (first)), scale (vreinterpretq_s32_u8 (second)));
+        }
+    }
+#elif defined (AUDIOFILE_SSE2)
+    const __m128 highScale = _mm_set1_ps (high);
+    const __m128 lowScale = _mm_set1_ps (low);
+
+    auto scale = [&] (__m128i x)
+    {
+        __m128 f = _mm_cvtepi32_ps (x);
+        return _mm_add_ps (_mm_mul_ps (f, highScale), _mm_mul_ps (f, lowScale));
+    };
+
+    auto store = [&] (size_t index, __m128 first, __m128 second)
+    {
+        if constexpr (Stereo)
+        {
+            _mm_storeu_ps (destinations[0] + index / 2, _mm_shuffle_ps (first, second, _MM_SHUFFLE (2, 0, 2, 0)));
+            _mm_storeu_ps (destinations[1] + index / 2, _mm_shuffle_ps (first, second, _MM_SHUFFLE (3, 1, 3, 1)));
+        }
+        else
+        {
+            _mm_storeu_ps (destinations[0] + index, first);
+            _mm_storeu_ps (destinations[0] + index + 4, second);
+        }
+    };
+
+    if constexpr (BitDepth == 8)
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m128i bytes = _mm_loadl_epi64 (reinterpret_cast<const __m128i*> (source + i));
+            __m128i wide = BigEndian ? _mm_srai_epi16 (_mm_unpacklo_epi8 (bytes, bytes), 8)
+                                     : _mm_sub_epi16 (_mm_unpacklo_epi8 (bytes, _mm_setzero_si128()), _mm_set1_epi16 (128));
+            store (i, scale (_mm_srai_epi32 (_mm_unpacklo_epi16 (wide, wide), 16)), scale (_mm_srai_epi32 (_mm_unpackhi_epi16 (wide, wide), 16)));
+        }
+    }
+    else if constexpr (BitDepth == 16)
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m128i wide = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i * 2));
+
+            if constexpr (BigEndian)
+                wide = _mm_or_si128 (_mm_slli_epi16 (wide, 8), _mm_srli_epi16 (wide, 8));
+
+            store (i, scale (_mm_srai_epi32 (_mm_unpacklo_epi16 (wide, wide), 16)), scale (_mm_srai_epi32 (_mm_unpackhi_epi16 (wide, wide), 16)));
+        }
+    }
+    else if constexpr (BitDepth == 24)
+    {
+#if defined (AUDIOFILE_SSSE3)
+        // move each sample's 3 bytes to the top of a 32-bit lane, then shift
+        // them back down to extend the sign. Each load reads 4 bytes past the
+        // 4 samples it uses, so stop while there are still samples to spare
+        const __m128i order = BigEndian ? _mm_setr_epi8 (-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9)
+                                        : _mm_setr_epi8 (-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+
+        for (; i + 10 <= numSamples; i += 8)
+        {
+            __m128i first = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i * 3));
+            __m128i second = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i * 3 + 12));
+            store (i, scale (_mm_srai_epi32 (_mm_shuffle_epi8 (first, order), 8)), scale (_mm_srai_epi32 (_mm_shuffle_epi8 (second, order), 8)));
+        }
+#endif
+    }
+    else
+    {
+        // swaps the bytes in each half of a lane, then the halves
+        auto swap = [] (__m128i x)
+        {
+            if constexpr (BigEndian)
+            {
+                x = _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8));
+                x = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (2, 3, 0, 1)), _MM_SHUFFLE (2, 3, 0, 1));
+            }
+
+            return x;
+        };
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m128i first = swap (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i * 4)));
+            __m128i second = swap (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i * 4 + 16)));
+
+            if constexpr (IsFloat)
+                store (i, _mm_castsi128_ps (first), _mm_castsi128_ps (second));
+            else
+                store (i, scale (first), scale (second));
+        }
+    }
+#endif
+
+    return i;
+}
+
+//=============================================================
+template <class T>
+template <int BitDepth, bool BigEndian, bool IsFloat, bool Stereo>
+size_t AudioSampleConverter<T>::floatsToBytesVectorised (const float* const* sources, uint8_t* destination, size_t numSamples)
+{
+    size_t i = 0;
+
+    // 32-bit floats are only copied. 16 and 24-bit samples are clamped,
+    // then scaled in double precision and truncated like the scalar code.
+    // The other formats are rare enough to leave to it. Each loop takes 8
+    // samples at a time, joining the channels together for stereo
+#if defined (AUDIOFILE_NEON)
+    auto load = [&] (size_t index, float32x4_t& first, float32x4_t& second)
+    {
+        if constexpr (Stereo)
+        {
+            float32x4x2_t frames = vzipq_f32 (vld1q_f32 (sources[0] + index / 2), vld1q_f32 (sources[1] + index / 2));
+            first = frames.val[0];
+            second = frames.val[1];
+        }
+        else
+        {
+            first = vld1q_f32 (sources[0] + index);
+            second = vld1q_f32 (sources[0] + index + 4);
+        }
+    };
+
+    if constexpr (BitDepth == 32 && IsFloat && ! BigEndian)
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            float32x4_t first, second;
+            load (i, first, second);
+            vst1q_f32 (reinterpret_cast<float*> (destination + i * 4), first);
+            vst1q_f32 (reinterpret_cast<float*> (destination + i * 4 + 16), second);
+        }
+    }
+    else if constexpr (BitDepth == 16 || BitDepth == 24)
+    {
+        const float64x2_t wideScale = vdupq_n_f64 (BitDepth == 16 ? 32767. : 8388607.);
+
+        auto convert = [&] (float32x4_t x)
+        {
+            x = vmaxq_f32 (vminq_f32 (x, vdupq_n_f32 (1.f)), vdupq_n_f32 (-1.f));
+            int64x2_t low = vcvtq_s64_f64 (vmulq_f64 (vcvt_f64_f32 (vget_low_f32 (x)), wideScale));
+            int64x2_t high = vcvtq_s64_f64 (vmulq_f64 (vcvt_high_f64_f32 (x), wideScale));
+            return vcombine_s32 (vmovn_s64 (low), vmovn_s64 (high));
+        };
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            float32x4_t first, second;
+            load (i, first, second);
+            int32x4_t firstInts = convert (first);
+            int32x4_t secondInts = convert (second);
+
+            if constexpr (BitDepth == 16)
+            {
+                uint8x16_t bytes = vreinterpretq_u8_s16 (vcombine_s16 (vmovn_s32 (firstInts), vmovn_s32 (secondInts)));
+
+                if constexpr (BigEndian)
+                    bytes = vrev16q_u8 (bytes);
+
+                vst1q_u8 (destination + i * 2, bytes);
+            }
+            else
+            {
+                // split the low 3 bytes of each sample into planes and store them interleaved
+                uint16x8_t low = vcombine_u16 (vmovn_u32 (vreinterpretq_u32_s32 (firstInts)), vmovn_u32 (vreinterpretq_u32_s32 (secondInts)));
+                uint16x8_t high = vcombine_u16 (vshrn_n_u32 (vreinterpretq_u32_s32 (firstInts), 16), vshrn_n_u32 (vreinterpretq_u32_s32 (secondInts), 16));
+                uint8x8x3_t bytes;
+                bytes.val[BigEndian ? 2 : 0] = vmovn_u16 (low);
+                bytes.val[1] = vshrn_n_u16 (low, 8);
+                bytes.val[BigEndian ? 0 : 2] = vmovn_u16 (high);
+                vst3_u8 (destination + i * 3, bytes);
+            }
+        }
+    }
+#elif defined (AUDIOFILE_SSE2)
+    auto load = [&] (size_t index, __m128& first, __m128& second)
+    {
+        if constexpr (Stereo)
+        {
+            __m128 left = _mm_loadu_ps (sources[0] + index / 2);
+            __m128 right = _mm_loadu_ps (sources[1] + index / 2);
+            first = _mm_unpacklo_ps (left, right);
+            second = _mm_unpackhi_ps (left, right);
+        }
+        else
+        {
+            first = _mm_loadu_ps (sources[0] + index);
+            second = _mm_loadu_ps (sources[0] + index + 4);
+        }
+    };
+
+    if constexpr (BitDepth == 32 && IsFloat && ! BigEndian)
+    {
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m128 first, second;
+            load (i, first, second);
+            _mm_storeu_ps (reinterpret_cast<float*> (destination + i * 4), first);
+            _mm_storeu_ps (reinterpret_cast<float*> (destination + i * 4 + 16), second);
+        }
+    }
+    else if constexpr (BitDepth == 16 || BitDepth == 24)
+    {
+        const __m128d wideScale = _mm_set1_pd (BitDepth == 16 ? 32767. : 8388607.);
+
+        auto convert = [&] (__m128 x)
+        {
+            x = _mm_max_ps (_mm_min_ps (x, _mm_set1_ps (1.f)), _mm_set1_ps (-1.f));
+            __m128i low = _mm_cvttpd_epi32 (_mm_mul_pd (_mm_cvtps_pd (x), wideScale));
+            __m128i high = _mm_cvttpd_epi32 (_mm_mul_pd (_mm_cvtps_pd (_mm_movehl_ps (x, x)), wideScale));
+            return _mm_unpacklo_epi64 (low, high);
+        };
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m128 first, second;
+            load (i, first, second);
+            __m128i firstInts = convert (first);
+            __m128i secondInts = convert (second);
+
+            if constexpr (BitDepth == 16)
+            {
+                __m128i words = _mm_packs_epi32 (firstInts, secondInts);
+
+                if constexpr (BigEndian)
+                    words = _mm_or_si128 (_mm_slli_epi16 (words, 8), _mm_srli_epi16 (words, 8));
+
+                _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i * 2), words);
+            }
+            else
+            {
+                int32_t values[8];
+                _mm_storeu_si128 (reinterpret_cast<__m128i*> (values), firstInts);
+                _mm_storeu_si128 (reinterpret_cast<__m128i*> (values + 4), secondInts);
+
+                for (int j = 0; j < 8; j++)
+                {
+                    uint8_t* bytes = destination + (i + j) * 3;
+                    bytes[BigEndian ? 2 : 0] = (uint8_t) values[j];
+                    bytes[1] = (uint8_t) (values[j] >> 8);
+                    bytes[BigEndian ? 0 : 2] = (uint8_t) (values[j] >> 16);
+                }
+            }
+        }
+    }
+#endif
+
+    return i;
+}
+
 //=============================================================
 template <class T>
 T AudioSampleConverter<T>::clamp (T value, T minValue, T maxValue)
@@ -0,0 +1,32 @@
+#ifndef PAT_PLAY_AUDIORENDERER_H
+#define PAT_PLAY_AUDIORENDERER_H
+
+#include <climits>
+#include <cstdint>
+
+/*!
+ * Fills blocks of audio for a stream. The Oboe callback in @a Sound drives one on a device, and
+ * anything else that can hand it buffers and block times, like the host tools in tools/audiobench,
+ * can drive one offline.
+ */
+class AudioRenderer {
+public:
+
+    // Passed as a block's start time when it isn't known.
+    static constexpr int64_t kUntimed = INT64_MIN;
+
+    virtual ~AudioRenderer() = default;
+
+    /*!
+     * Renders the next block. Called from the audio thread, so this must not block or allocate.
+     * @param outputBuffer Interleaved output, overwritten
+     * @param numFrames Frames to render
+     * @param numChannels Channels in the output
+     * @param blockStartNs The monotonic time that the first frame of the block stands for, or
+     * @a kUntimed
+     */
+    virtual void render(float *outputBuffer, int32_t numFrames, int32_t numChannels, int64_t blockStartNs) = 0;
+
+};
+
+#endif //PAT_PLAY_AUDIORENDERER_H
@@ -0,0 +1,86 @@
+#include "AudioStats.h"
+
+#include <limits>
+
+// Upper limit of the first histogram bucket. Each bucket after it doubles.
+static constexpr int64_t kFirstBucketNs = 50000;
+
+int64_t AudioStats::getBucketLimitNs(int bucket) {
+    if (bucket >= AudioStatsSnapshot::kBucketCount - 1) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return kFirstBucketNs << bucket;
+}
+
+void AudioStats::recordCallback(int64_t durationNs, int64_t deadlineNs, int32_t activeVoices) {
+
+    // The audio thread is the only writer, so a load and store is enough and never retries.
+    int bucket = 0;
+    while (durationNs >= getBucketLimitNs(bucket)) {
+        bucket++;
+    }
+    auto &count = histogram_[bucket];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    callbacks_.store(callbacks_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (durationNs > maxCallbackNs_.load(std::memory_order_relaxed)) {
+        maxCallbackNs_.store(durationNs, std::memory_order_relaxed);
+    }
+    deadlineNs_.store(deadlineNs, std::memory_order_relaxed);
+
+    activeVoices_.store(activeVoices, std::memory_order_relaxed);
+    if (activeVoices > peakVoices_.load(std::memory_order_relaxed)) {
+        peakVoices_.store(activeVoices, std::memory_order_relaxed);
+    }
+
+}
+
+void AudioStats::setStreamInfo(SampleFormat outputFormat, bool mmap, bool exclusive) {
+    outputFormat_.store(outputFormat, std::memory_order_relaxed);
+    mmap_.store(mmap, std::memory_order_relaxed);
+    exclusive_.store(exclusive, std::memory_order_relaxed);
+}
+
+AudioStatsSnapshot AudioStats::snapshot() const {
+
+    AudioStatsSnapshot snapshot {};
+    for (int i = 0; i < AudioStatsSnapshot::kBucketCount; i++) {
+        snapshot.histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.callbacks = callbacks_.load(std::memory_order_relaxed);
+    snapshot.maxCallbackNs = maxCallbackNs_.load(std::memory_order_relaxed);
+    snapshot.deadlineNs = deadlineNs_.load(std::memory_order_relaxed);
+    snapshot.activeVoices = activeVoices_.load(std::memory_order_relaxed);
+    snapshot.peakVoices = peakVoices_.load(std::memory_order_relaxed);
+    snapshot.droppedTriggers = droppedTriggers_.load(std::memory_order_relaxed);
+    snapshot.xRunCount = xRunCount_.load(std::memory_order_relaxed);
+    snapshot.outputFormat = outputFormat_.load(std::memory_order_relaxed);
+    snapshot.mmap = mmap_.load(std::memory_order_relaxed);
+    snapshot.exclusive = exclusive_.load(std::memory_order_relaxed);
+
+    return snapshot;
+
+}
+
+int64_t AudioStatsSnapshot::getPercentileNs(double percent) const {
+
+    // Counted from the histogram rather than the callback total, since the two are read apart.
+    uint64_t total = 0;
+    for (auto count : histogram) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    auto target = (uint64_t) ((percent / 100.0) * (double) total);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; i++) {
+        seen += histogram[i];
+        if (seen >= target && seen > 0) {
+            return i == kBucketCount - 1 ? maxCallbackNs : AudioStats::getBucketLimitNs(i);
+        }
+    }
+    return maxCallbackNs;
+
+}
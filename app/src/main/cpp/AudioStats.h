@@ -0,0 +1,125 @@
+#ifndef PAT_PLAY_AUDIOSTATS_H
+#define PAT_PLAY_AUDIOSTATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "SoundBuffer.h"
+
+/*!
+ * A copy of the audio counters at one point in time. Each value is read on its own, so values
+ * can be a callback apart from each other, which is fine for logging and overlays.
+ */
+struct AudioStatsSnapshot {
+    static constexpr int kBucketCount = 12;
+
+    // Callbacks by duration, see @a AudioStats::getBucketLimitNs for the ranges.
+    std::array<uint32_t, kBucketCount> histogram;
+
+    uint32_t callbacks;
+    int64_t maxCallbackNs;
+    int64_t deadlineNs;
+    int32_t activeVoices;
+    int32_t peakVoices;
+    uint32_t droppedTriggers;
+
+    // Underruns reported by the stream, or -1 if it can't say.
+    int32_t xRunCount;
+
+    // What the stream plays, Int16 when the mixer writes 16-bit PCM for it directly.
+    SampleFormat outputFormat;
+
+    // Whether the stream got the MMAP path, which skips a copy through the audio server, and
+    // whether it has the device to itself.
+    bool mmap;
+    bool exclusive;
+
+    /*!
+     * @return the callback duration that at least @a percent of callbacks came in under, rounded up
+     * to the end of a histogram bucket
+     */
+    int64_t getPercentileNs(double percent) const;
+};
+
+/*!
+ * Lock-free counters describing how the audio callback is doing. The audio thread records into
+ * them, and any thread can take a @a snapshot without blocking it.
+ *
+ * Everything but the dropped trigger count has the audio thread as its only writer, so those are
+ * plain relaxed stores with no read-modify-write. The stream info is written before the stream
+ * starts, by whichever thread opened it.
+ */
+class AudioStats {
+public:
+
+    inline AudioStats():
+            histogram_(),
+            callbacks_(0),
+            maxCallbackNs_(0),
+            deadlineNs_(0),
+            activeVoices_(0),
+            peakVoices_(0),
+            droppedTriggers_(0),
+            xRunCount_(-1),
+            outputFormat_(SampleFormat::Float),
+            mmap_(false),
+            exclusive_(false) {}
+
+    /*!
+     * Records one callback. Only call this from the audio thread.
+     * @param durationNs How long the callback took, on a monotonic clock
+     * @param deadlineNs How long it had, the duration of the audio it rendered
+     * @param activeVoices Voices playing after the callback
+     */
+    void recordCallback(int64_t durationNs, int64_t deadlineNs, int32_t activeVoices);
+
+    /*!
+     * Counts triggers that never became a voice. Safe from any thread.
+     */
+    inline void addDroppedTriggers(uint32_t count) {
+        droppedTriggers_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /*!
+     * Records the stream's underrun count, or -1 if it can't say. Only call this from the audio
+     * thread.
+     */
+    inline void recordXRunCount(int32_t xRunCount) {
+        xRunCount_.store(xRunCount, std::memory_order_relaxed);
+    }
+
+    /*!
+     * Records how a newly opened stream plays, so snapshots don't have to ask the stream.
+     * Call this before the stream starts.
+     */
+    void setStreamInfo(SampleFormat outputFormat, bool mmap, bool exclusive);
+
+    /*!
+     * Copies out the counters. Safe from any thread.
+     */
+    AudioStatsSnapshot snapshot() const;
+
+    /*!
+     * @return the exclusive upper limit of a histogram bucket's durations. Buckets double from
+     * 50us, and the last one has no limit.
+     */
+    static int64_t getBucketLimitNs(int bucket);
+
+private:
+
+    std::array<std::atomic<uint32_t>, AudioStatsSnapshot::kBucketCount> histogram_;
+    std::atomic<uint32_t> callbacks_;
+    std::atomic<int64_t> maxCallbackNs_;
+    std::atomic<int64_t> deadlineNs_;
+    std::atomic<int32_t> activeVoices_;
+    std::atomic<int32_t> peakVoices_;
+    std::atomic<uint32_t> droppedTriggers_;
+    std::atomic<int32_t> xRunCount_;
+    std::atomic<SampleFormat> outputFormat_;
+    std::atomic<bool> mmap_;
+    std::atomic<bool> exclusive_;
+
+};
+
+#endif //PAT_PLAY_AUDIOSTATS_H
@@ -0,0 +1,88 @@
+#include "GpuResources.h"
+
+/*!
+ * Generations start at 1 and skip 0 when they wrap, so a zeroed handle never matches a slot.
+ */
+static inline uint16_t nextGeneration(uint16_t generation) {
+    generation++;
+    return generation == 0 ? 1 : generation;
+}
+
+GpuHandle GpuResources::add(GpuResourceKind kind, GLuint name) {
+    uint16_t index;
+    if (!freeSlots_.empty()) {
+        index = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        index = (uint16_t) names_.size();
+        names_.push_back(0);
+        generations_.push_back(0);
+        kinds_.push_back(kind);
+    }
+
+    auto generation = nextGeneration(generations_[index]);
+    names_[index] = name;
+    generations_[index] = generation;
+    kinds_[index] = kind;
+
+    return GpuHandle { index, generation };
+}
+
+void GpuResources::replace(GpuHandle handle, GLuint name) {
+    if (isValid(handle)) {
+        deleteObject(kinds_[handle.index], names_[handle.index]);
+        names_[handle.index] = name;
+    }
+}
+
+void GpuResources::destroy(GpuHandle handle) {
+    if (!isValid(handle)) {
+        return;
+    }
+
+    // Bump the generation so any copies of the handle stop resolving.
+    deleteObject(kinds_[handle.index], names_[handle.index]);
+    names_[handle.index] = 0;
+    generations_[handle.index] = nextGeneration(generations_[handle.index]);
+    freeSlots_.push_back(handle.index);
+}
+
+void GpuResources::destroyAll() {
+    for (size_t i = 0; i < names_.size(); i++) {
+        deleteObject(kinds_[i], names_[i]);
+    }
+
+    // Generations are kept, so handles from before this can't match a reused slot.
+    freeSlots_.clear();
+    for (size_t i = 0; i < names_.size(); i++) {
+        names_[i] = 0;
+        generations_[i] = nextGeneration(generations_[i]);
+        freeSlots_.push_back((uint16_t) i);
+    }
+}
+
+void GpuResources::abandonAll() {
+    for (auto &name : names_) {
+        name = 0;
+    }
+}
+
+void GpuResources::deleteObject(GpuResourceKind kind, GLuint name) {
+    if (name == 0) {
+        return;
+    }
+    switch (kind) {
+        case GpuResourceKind::Texture:
+            glDeleteTextures(1, &name);
+            break;
+        case GpuResourceKind::Program:
+            glDeleteProgram(name);
+            break;
+        case GpuResourceKind::Buffer:
+            glDeleteBuffers(1, &name);
+            break;
+        case GpuResourceKind::VertexArray:
+            glDeleteVertexArrays(1, &name);
+            break;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef PAT_PLAY_GPURESOURCES_H
+#define PAT_PLAY_GPURESOURCES_H
+
+#include <cstdint>
+#include <vector>
+
+#include <GLES3/gl3.h>
+
+/*!
+ * The kinds of GL object the registry knows how to delete.
+ */
+enum class GpuResourceKind : uint8_t {
+    Texture,
+    Program,
+    Buffer,
+    VertexArray,
+};
+
+/*!
+ * A small, copyable reference to a GL object owned by @a GpuResources. A default constructed handle
+ * is never valid, and a handle stops being valid once its object is destroyed, even if the slot is
+ * reused.
+ */
+struct GpuHandle {
+    uint16_t index = 0;
+
+    // Never 0 for a handle the registry gave out, so a default constructed one matches nothing.
+    uint16_t generation = 0;
+};
+
+/*!
+ * Owns GL object names, keeping them in one flat array that handles index into. Looking a handle
+ * up is an array read and a generation compare, with no reference counting.
+ *
+ * Every object can be deleted in one call, or, when the context has been lost and the names are
+ * already gone, forgotten in one call.
+ */
+class GpuResources {
+public:
+    inline GpuResources() {}
+
+    inline ~GpuResources() {
+        destroyAll();
+    }
+
+    /*!
+     * Takes ownership of a GL object.
+     * @return a handle to it
+     */
+    GpuHandle add(GpuResourceKind kind, GLuint name);
+
+    /*!
+     * Swaps the object behind a handle for a new one, deleting the old one. Handles to it stay valid.
+     */
+    void replace(GpuHandle handle, GLuint name);
+
+    /*!
+     * Deletes the object behind a handle. Does nothing if the handle isn't valid.
+     */
+    void destroy(GpuHandle handle);
+
+    /*!
+     * Deletes every object and invalidates every handle. Needs the owning context to be current.
+     */
+    void destroyAll();
+
+    /*!
+     * Forgets every object without deleting it, for when the context has been lost and taken the
+     * objects with it. Handles stay valid but resolve to 0 until their object is replaced.
+     */
+    void abandonAll();
+
+    inline bool isValid(GpuHandle handle) const {
+        return handle.index < generations_.size() && generations_[handle.index] == handle.generation;
+    }
+
+    /*!
+     * @return the GL name behind a handle, or 0 if the handle isn't valid
+     */
+    inline GLuint get(GpuHandle handle) const {
+        return isValid(handle) ? names_[handle.index] : 0;
+    }
+
+private:
+    static void deleteObject(GpuResourceKind kind, GLuint name);
+
+    std::vector<GLuint> names_;
+    std::vector<uint16_t> generations_;
+    std::vector<GpuResourceKind> kinds_;
+    std::vector<uint16_t> freeSlots_;
+};
+
+#endif //PAT_PLAY_GPURESOURCES_H
@@ -0,0 +1,175 @@
+#include "Mix.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Scales 16-bit PCM to the -1 to 1 range of float samples.
+static constexpr float kPcm16Scale = 1.0f / 32768.0f;
+
+// The other way, with the limits float samples are clamped to first.
+static constexpr float kFloatToPcm16Scale = 32768.0f;
+static constexpr float kPcm16Min = -32768.0f;
+static constexpr float kPcm16Max = 32767.0f;
+
+/*!
+ * A constant gain works for any channel count. For a ramp, each lane of a four sample vector is
+ * some whole frames into the block, so it gets the gain that far along the ramp. That only lines up
+ * for channel counts that divide four, so other ramps are left to the scalar loop.
+ *
+ * @return whether the ramp can be vectorized, filling in the starting gain of each lane
+ */
+static inline bool rampLanes(int32_t numChannels, float gain, float gainStep, float *lanes, float *step) {
+    auto vectorize = gainStep == 0.0f || numChannels == 1 || numChannels == 2 || numChannels == 4;
+    auto framesPerVector = numChannels <= 4 ? 4 / numChannels : 0;
+    for (auto l = 0; l < 4; l++) {
+        lanes[l] = gain + gainStep * (float) (l / numChannels);
+    }
+    *step = gainStep * (float) framesPerVector;
+    return vectorize;
+}
+
+void mixFrames(float *outputBuffer, const float *source, int32_t numFrames, int32_t numChannels, float gain, float gainStep) {
+
+    auto numSamples = numFrames * numChannels;
+    int32_t i = 0;
+
+    float lanes[4];
+    float laneStep;
+    auto vectorize = rampLanes(numChannels, gain, gainStep, lanes, &laneStep);
+
+#if defined(__ARM_NEON)
+    if (gainStep == 0.0f) {
+        const float32x4_t gains = vdupq_n_f32(gain);
+        for (; i + 4 <= numSamples; i += 4) {
+            vst1q_f32(outputBuffer + i, vmlaq_f32(vld1q_f32(outputBuffer + i), vld1q_f32(source + i), gains));
+        }
+    } else if (vectorize) {
+        float32x4_t gains = vld1q_f32(lanes);
+        const float32x4_t step = vdupq_n_f32(laneStep);
+        for (; i + 4 <= numSamples; i += 4) {
+            vst1q_f32(outputBuffer + i, vmlaq_f32(vld1q_f32(outputBuffer + i), vld1q_f32(source + i), gains));
+            gains = vaddq_f32(gains, step);
+        }
+    }
+#elif defined(__SSE2__)
+    if (gainStep == 0.0f) {
+        const __m128 gains = _mm_set1_ps(gain);
+        for (; i + 4 <= numSamples; i += 4) {
+            auto scaled = _mm_mul_ps(_mm_loadu_ps(source + i), gains);
+            _mm_storeu_ps(outputBuffer + i, _mm_add_ps(_mm_loadu_ps(outputBuffer + i), scaled));
+        }
+    } else if (vectorize) {
+        __m128 gains = _mm_loadu_ps(lanes);
+        const __m128 step = _mm_set1_ps(laneStep);
+        for (; i + 4 <= numSamples; i += 4) {
+            auto scaled = _mm_mul_ps(_mm_loadu_ps(source + i), gains);
+            _mm_storeu_ps(outputBuffer + i, _mm_add_ps(_mm_loadu_ps(outputBuffer + i), scaled));
+            gains = _mm_add_ps(gains, step);
+        }
+    }
+#endif
+
+    // Whatever is left over, or everything without SIMD.
+    for (; i < numSamples; i++) {
+        outputBuffer[i] += source[i] * (gain + gainStep * (float) (i / numChannels));
+    }
+
+}
+
+void mixFrames(float *outputBuffer, const int16_t *source, int32_t numFrames, int32_t numChannels, float gain, float gainStep) {
+
+    // Fold the PCM scale into the gain, so widening is just an integer to float conversion.
+    gain *= kPcm16Scale;
+    gainStep *= kPcm16Scale;
+
+    auto numSamples = numFrames * numChannels;
+    int32_t i = 0;
+
+    float lanes[4];
+    float laneStep;
+    auto vectorize = rampLanes(numChannels, gain, gainStep, lanes, &laneStep);
+
+#if defined(__ARM_NEON)
+    if (gainStep == 0.0f) {
+        const float32x4_t gains = vdupq_n_f32(gain);
+        for (; i + 4 <= numSamples; i += 4) {
+            auto widened = vcvtq_f32_s32(vmovl_s16(vld1_s16(source + i)));
+            vst1q_f32(outputBuffer + i, vmlaq_f32(vld1q_f32(outputBuffer + i), widened, gains));
+        }
+    } else if (vectorize) {
+        float32x4_t gains = vld1q_f32(lanes);
+        const float32x4_t step = vdupq_n_f32(laneStep);
+        for (; i + 4 <= numSamples; i += 4) {
+            auto widened = vcvtq_f32_s32(vmovl_s16(vld1_s16(source + i)));
+            vst1q_f32(outputBuffer + i, vmlaq_f32(vld1q_f32(outputBuffer + i), widened, gains));
+            gains = vaddq_f32(gains, step);
+        }
+    }
+#elif defined(__SSE2__)
+    if (gainStep == 0.0f) {
+        const __m128 gains = _mm_set1_ps(gain);
+        for (; i + 4 <= numSamples; i += 4) {
+            // Duplicate each sample into both halves of a 32-bit lane, then shift down to sign extend.
+            auto pcm = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + i));
+            auto widened = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16));
+            _mm_storeu_ps(outputBuffer + i, _mm_add_ps(_mm_loadu_ps(outputBuffer + i), _mm_mul_ps(widened, gains)));
+        }
+    } else if (vectorize) {
+        __m128 gains = _mm_loadu_ps(lanes);
+        const __m128 step = _mm_set1_ps(laneStep);
+        for (; i + 4 <= numSamples; i += 4) {
+            auto pcm = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + i));
+            auto widened = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16));
+            _mm_storeu_ps(outputBuffer + i, _mm_add_ps(_mm_loadu_ps(outputBuffer + i), _mm_mul_ps(widened, gains)));
+            gains = _mm_add_ps(gains, step);
+        }
+    }
+#endif
+
+    // Whatever is left over, or everything without SIMD.
+    for (; i < numSamples; i++) {
+        outputBuffer[i] += (float) source[i] * (gain + gainStep * (float) (i / numChannels));
+    }
+
+}
+
+void floatToPcm16(int16_t *output, const float *input, int32_t numSamples) {
+
+    int32_t i = 0;
+
+    // Clamped in float first, since an out of range conversion isn't saturated on every target.
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(kFloatToPcm16Scale);
+    const float32x4_t low = vdupq_n_f32(kPcm16Min);
+    const float32x4_t high = vdupq_n_f32(kPcm16Max);
+    for (; i + 8 <= numSamples; i += 8) {
+        auto a = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(input + i), scale), low), high);
+        auto b = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(input + i + 4), scale), low), high);
+        vst1q_s16(output + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+#elif defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(kFloatToPcm16Scale);
+    const __m128 low = _mm_set1_ps(kPcm16Min);
+    const __m128 high = _mm_set1_ps(kPcm16Max);
+    for (; i + 8 <= numSamples; i += 8) {
+        auto a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i), scale), low), high);
+        auto b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale), low), high);
+        auto packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), packed);
+    }
+#endif
+
+    // Whatever is left over, or everything without SIMD. 32-bit NEON has no rounding conversion,
+    // so it comes through here too.
+    for (; i < numSamples; i++) {
+        auto sample = std::min(std::max(input[i] * kFloatToPcm16Scale, kPcm16Min), kPcm16Max);
+        output[i] = (int16_t) lrintf(sample);
+    }
+
+}
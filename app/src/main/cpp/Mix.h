@@ -0,0 +1,27 @@
+#ifndef PAT_PLAY_MIX_H
+#define PAT_PLAY_MIX_H
+
+#include <cstdint>
+
+/*!
+ * Inner loops of the mixer. Each adds a block of interleaved source frames into an interleaved
+ * output with the same channel count, scaled by a gain that starts at @a gain and changes by
+ * @a gainStep every frame.
+ *
+ * Uses NEON or SSE where the target has it, with a scalar fallback otherwise. Ramped gains are only
+ * vectorized for 1, 2 and 4 channels, which fit evenly into a vector.
+ */
+void mixFrames(float *outputBuffer, const float *source, int32_t numFrames, int32_t numChannels, float gain, float gainStep);
+
+/*!
+ * Like the float version, but widens signed 16-bit PCM to float as it mixes.
+ */
+void mixFrames(float *outputBuffer, const int16_t *source, int32_t numFrames, int32_t numChannels, float gain, float gainStep);
+
+/*!
+ * Converts float samples to signed 16-bit PCM, rounding to the nearest step. Anything past full
+ * scale saturates rather than wrapping around.
+ */
+void floatToPcm16(int16_t *output, const float *input, int32_t numSamples);
+
+#endif //PAT_PLAY_MIX_H
@@ -0,0 +1,310 @@
+#include "Mixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Mix.h"
+
+// Frames a stolen voice takes to fade to silence, about 3ms at 44.1kHz.
+static constexpr int32_t kFadeFrames = 128;
+
+// Loudest a voice started by several triggers of one sound in the same block can be. The limiter
+// keeps the mix in range however loud it gets.
+static constexpr float kMaxCoalescedGain = 1.5f;
+
+// How long the limiter takes to bring the gain back up from silence to 1.
+static constexpr float kLimiterReleaseSeconds = 0.25f;
+
+// Most stolen voices that can fade out at once. Past this the quietest one is cut short.
+static constexpr size_t kMaxReleasingVoices = 8;
+
+static constexpr int64_t kNanosPerSecond = 1000000000;
+
+/*!
+ * Whether voice age @a a started before @a b, allowing for the counter wrapping.
+ */
+static inline bool isOlder(uint32_t a, uint32_t b) {
+    return (int32_t) (a - b) < 0;
+}
+
+Mixer::Mixer(int maxVoices):
+        bank_(nullptr),
+        streamPlayer_(nullptr),
+        pending_(),
+        delays_(),
+        triggered_(),
+        voices_(maxVoices > 0 ? maxVoices : 1),
+        voiceCount_(0),
+        releasing_(kMaxReleasingVoices),
+        releasingCount_(0),
+        stats_(nullptr),
+        sampleRate_(0),
+        nextAge_(0),
+        limiterGain_(1.0f) {}
+
+void Mixer::setBank(const SoundBank *bank) {
+    bank_ = bank;
+}
+
+void Mixer::setStreamPlayer(StreamPlayer *player) {
+    streamPlayer_ = player;
+}
+
+void Mixer::setStats(AudioStats *stats) {
+    stats_ = stats;
+}
+
+void Mixer::setSampleRate(int32_t sampleRate) {
+    sampleRate_ = sampleRate;
+}
+
+void Mixer::reservePcm16(int32_t numFrames, int32_t numChannels) {
+    pcm16Mix_.assign((size_t) std::max(numFrames, 0) * std::max(numChannels, 0), 0.0f);
+}
+
+bool Mixer::trigger(int32_t sound, int64_t timeNs) {
+    if (sound < 0 || sound >= SoundBank::kMaxSounds || !triggers_.push(SoundTrigger { sound, timeNs })) {
+        if (stats_) {
+            stats_->addDroppedTriggers(1);
+        }
+        return false;
+    }
+    return true;
+}
+
+void Mixer::startVoice(int32_t sound, float gain, int32_t delay) {
+
+    // A sound still loading is dropped like one that failed to, rather than waited for.
+    if (!bank_ || !bank_->isLoaded(sound)) {
+        if (stats_) {
+            stats_->addDroppedTriggers(1);
+        }
+        return;
+    }
+
+    Voice voice { sound, 0, delay, bank_->getEntry(sound).priority, nextAge_++, gain, 0.0f };
+    if (voiceCount_ < voices_.size()) {
+        voices_[voiceCount_++] = voice;
+        return;
+    }
+
+    // The pool is full, so steal the lowest priority voice, and the oldest of those.
+    size_t victim = 0;
+    for (size_t i = 1; i < voiceCount_; i++) {
+        auto &v = voices_[i];
+        auto &best = voices_[victim];
+        if (v.priority < best.priority || (v.priority == best.priority && isOlder(v.age, best.age))) {
+            victim = i;
+        }
+    }
+
+    // Never cut off something more important than what is starting.
+    if (voices_[victim].priority > voice.priority) {
+        if (stats_) {
+            stats_->addDroppedTriggers(1);
+        }
+        return;
+    }
+
+    release(voices_[victim]);
+    voices_[victim] = voice;
+
+}
+
+void Mixer::release(const Voice &voice) {
+
+    // Nothing has been heard from a voice that hasn't started, so there's nothing to fade.
+    if (voice.delay > 0) {
+        return;
+    }
+
+    size_t slot = releasingCount_;
+    if (slot < releasing_.size()) {
+        releasingCount_++;
+    } else {
+        // No room, so replace whichever fading voice is already quietest.
+        slot = 0;
+        for (size_t i = 1; i < releasingCount_; i++) {
+            if (releasing_[i].gain < releasing_[slot].gain) {
+                slot = i;
+            }
+        }
+    }
+
+    auto &fading = releasing_[slot];
+    fading = voice;
+    fading.gainStep = -voice.gain / kFadeFrames;
+
+}
+
+bool Mixer::mixVoice(Voice &voice, float *outputBuffer, int32_t numFrames, int32_t numChannels) const {
+
+    if (bank_->getNumChannels() != numChannels) {
+        return false;
+    }
+
+    // A voice that starts partway into the block is mixed from that frame on.
+    auto start = std::min(voice.delay, numFrames);
+    voice.delay -= start;
+    outputBuffer += start * numChannels;
+
+    // Mix from the cursor position, finishing either at the end of the sound,
+    // the end of the fade or the end of "numFrames".
+    auto frameCount = bank_->getNumFrames(voice.sound);
+    auto frames = std::min(numFrames - start, frameCount - voice.cursor);
+    auto faded = false;
+    if (voice.gainStep < 0.0f) {
+        auto fadeFrames = (int32_t) std::ceil(voice.gain / -voice.gainStep);
+        faded = fadeFrames <= frames;
+        frames = std::min(frames, fadeFrames);
+    }
+
+    auto offset = voice.cursor * numChannels;
+    if (bank_->getFormat() == SampleFormat::Int16) {
+        mixFrames(outputBuffer, bank_->getPcm16(voice.sound) + offset, frames, numChannels, voice.gain, voice.gainStep);
+    } else {
+        mixFrames(outputBuffer, bank_->getData(voice.sound) + offset, frames, numChannels, voice.gain, voice.gainStep);
+    }
+
+    voice.cursor += frames;
+    voice.gain += voice.gainStep * frames;
+
+    return voice.cursor < frameCount && !faded;
+
+}
+
+int32_t Mixer::frameOffset(int64_t timeNs, int64_t blockStartNs, int32_t numFrames) const {
+
+    if (blockStartNs == kUntimed || sampleRate_ <= 0) {
+        return 0;
+    }
+
+    // Late triggers start straight away. Early ones, which shouldn't happen with a sensible block
+    // time, start at the end of the block rather than being held back.
+    auto elapsedNs = std::clamp<int64_t>(timeNs - blockStartNs, 0, kNanosPerSecond);
+    auto offset = (elapsedNs * sampleRate_) / kNanosPerSecond;
+    return (int32_t) std::min<int64_t>(offset, numFrames - 1);
+
+}
+
+void Mixer::render(float *outputBuffer, int32_t numFrames, int32_t numChannels, int64_t blockStartNs) {
+    startTriggered(numFrames, blockStartNs);
+    mixBlock(outputBuffer, numFrames, numChannels);
+}
+
+void Mixer::startTriggered(int32_t numFrames, int64_t blockStartNs) {
+
+    // Start any sounds the game thread asked for since the last render, each on the frame its
+    // timestamp falls on. Triggers of the same sound in one block get one voice, starting with the
+    // earliest and louder for each extra trigger up to a cap, so a burst costs the same to mix as
+    // a single tap.
+    size_t triggeredCount = 0;
+    SoundTrigger trigger;
+    while (triggers_.pop(trigger)) {
+        auto sound = trigger.sound;
+        auto offset = frameOffset(trigger.timeNs, blockStartNs, numFrames);
+        if (pending_[sound] == 0) {
+            triggered_[triggeredCount++] = sound;
+            delays_[sound] = offset;
+        } else {
+            delays_[sound] = std::min(delays_[sound], offset);
+        }
+        pending_[sound]++;
+    }
+    for (size_t i = 0; i < triggeredCount; i++) {
+        auto sound = triggered_[i];
+        startVoice(sound, std::min((float) pending_[sound], kMaxCoalescedGain), delays_[sound]);
+        pending_[sound] = 0;
+    }
+
+}
+
+void Mixer::mixBlock(float *outputBuffer, int32_t numFrames, int32_t numChannels) {
+
+    // Clear the sound.
+    memset(outputBuffer, 0, sizeof(float) * numFrames * numChannels);
+
+    // Mix each voice, swapping finished ones out of the packed range.
+    for (size_t i = 0; i < voiceCount_;) {
+        if (mixVoice(voices_[i], outputBuffer, numFrames, numChannels)) {
+            i++;
+        } else {
+            voices_[i] = voices_[--voiceCount_];
+        }
+    }
+    for (size_t i = 0; i < releasingCount_;) {
+        if (mixVoice(releasing_[i], outputBuffer, numFrames, numChannels)) {
+            i++;
+        } else {
+            releasing_[i] = releasing_[--releasingCount_];
+        }
+    }
+
+    if (streamPlayer_) {
+        streamPlayer_->mix(outputBuffer, numFrames, numChannels);
+    }
+
+    limit(outputBuffer, numFrames, numChannels);
+
+}
+
+void Mixer::limit(float *outputBuffer, int32_t numFrames, int32_t numChannels) {
+
+    // Each frame gets just enough gain to stay in range, and the gain only climbs back towards 1
+    // gradually, so a loud frame pulls the mix down without distorting it. Working frame by frame
+    // means a block comes out the same however it's split up. Most blocks are nowhere near full
+    // scale, and are passed through after one look.
+    auto numSamples = numFrames * numChannels;
+    if (limiterGain_ == 1.0f) {
+        float peak = 0.0f;
+        for (int32_t i = 0; i < numSamples; i++) {
+            peak = std::max(peak, std::fabs(outputBuffer[i]));
+        }
+        if (peak <= 1.0f) {
+            return;
+        }
+    }
+
+    auto releasePerFrame = sampleRate_ > 0 ? 1.0f / (kLimiterReleaseSeconds * (float) sampleRate_) : 1.0f;
+    auto gain = limiterGain_;
+    for (int32_t frame = 0; frame < numFrames; frame++) {
+        auto *samples = outputBuffer + (size_t) frame * numChannels;
+        float peak = 0.0f;
+        for (int32_t channel = 0; channel < numChannels; channel++) {
+            peak = std::max(peak, std::fabs(samples[channel]));
+        }
+        gain = std::min(gain + releasePerFrame, 1.0f);
+        if (peak * gain > 1.0f) {
+            gain = 1.0f / peak;
+        }
+        if (gain < 1.0f) {
+            for (int32_t channel = 0; channel < numChannels; channel++) {
+                samples[channel] *= gain;
+            }
+        }
+    }
+    limiterGain_ = gain;
+
+}
+
+void Mixer::render(int16_t *outputBuffer, int32_t numFrames, int32_t numChannels, int64_t blockStartNs) {
+
+    auto maxFrames = numChannels > 0 ? (int32_t) (pcm16Mix_.size() / numChannels) : 0;
+    if (maxFrames == 0) {
+        memset(outputBuffer, 0, sizeof(int16_t) * numFrames * numChannels);
+        return;
+    }
+
+    // Mix in float as usual, then convert. Triggers are placed across the whole block, and a block
+    // too long for the mix buffer is mixed in pieces. A voice's delay carries over from one piece
+    // to the next, so each still starts on its own frame.
+    startTriggered(numFrames, blockStartNs);
+    for (int32_t done = 0; done < numFrames;) {
+        auto frames = std::min(numFrames - done, maxFrames);
+        mixBlock(pcm16Mix_.data(), frames, numChannels);
+        floatToPcm16(outputBuffer + (size_t) done * numChannels, pcm16Mix_.data(), frames * numChannels);
+        done += frames;
+    }
+
+}
@@ -0,0 +1,184 @@
+#ifndef PAT_PLAY_MIXER_H
+#define PAT_PLAY_MIXER_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "AudioRenderer.h"
+#include "AudioStats.h"
+#include "SoundBank.h"
+#include "SpscQueue.h"
+#include "StreamPlayer.h"
+
+/*!
+ * A request from the game thread to start playing a sound.
+ */
+struct SoundTrigger {
+    // The sound's number in the bank.
+    int32_t sound;
+
+    // When it was asked for, in nanoseconds on the monotonic clock.
+    int64_t timeNs;
+};
+
+/*!
+ * Mixes the playing sounds into an interleaved float or 16-bit buffer. Knows nothing about the audio device,
+ * so whatever owns the stream calls @a render from its callback.
+ *
+ * Voices come from a fixed pool, so the cost of a render is bounded by the maximum polyphony no
+ * matter how fast triggers arrive. When the pool is full a new trigger steals the lowest priority,
+ * oldest voice, which fades out over a few milliseconds instead of cutting off with a click.
+ *
+ * Triggers are timestamped, and when a render knows which time its block stands for, each sound
+ * starts on the frame matching its timestamp rather than at the start of the block. Triggers of one
+ * sound that land in the same block are merged into a single louder voice.
+ *
+ * The finished mix goes through a limiter, which turns the whole output down as soon as a frame
+ * would go over full scale and brings it back up over a fraction of a second, so a pile of voices
+ * never clips.
+ *
+ * Sounds are played from a @a SoundBank, which can still be loading while the mixer renders. Until
+ * a sound is published in the bank its triggers are dropped and counted.
+ */
+class Mixer: public AudioRenderer {
+public:
+
+    static constexpr int kDefaultMaxVoices = 32;
+
+    /*!
+     * @param maxVoices The most voices that can play at once
+     */
+    explicit Mixer(int maxVoices = kDefaultMaxVoices);
+
+    /*!
+     * Sets the sounds to play. Only call this while nothing is rendering.
+     * @param bank The sounds, in the output's channel count and rate. May be null.
+     */
+    void setBank(const SoundBank *bank);
+
+    /*!
+     * Sets a streamed sound to mix in over the voices, such as music. Only call this while nothing
+     * is rendering.
+     * @param player The player, may be null
+     */
+    void setStreamPlayer(StreamPlayer *player);
+
+    /*!
+     * Sets where to count triggers that never become a voice. Only call this while nothing is
+     * rendering or triggering.
+     * @param stats The counters, may be null
+     */
+    void setStats(AudioStats *stats);
+
+    /*!
+     * Sets the rate of the output, used to turn trigger times into frames. Only call this while
+     * nothing is rendering.
+     */
+    void setSampleRate(int32_t sampleRate);
+
+    /*!
+     * Makes room to render 16-bit blocks, which are mixed in float first. Only call this while
+     * nothing is rendering.
+     * @param numFrames The longest block expected. Longer ones still work, rendered in pieces.
+     * @param numChannels Channels in the output
+     */
+    void reservePcm16(int32_t numFrames, int32_t numChannels);
+
+    /*!
+     * Queues a sound to start on the next render. Only call this from one thread.
+     * @param sound The sound's number in the bank
+     * @param timeNs When the sound was asked for, on the same clock as @a render's block times
+     * @return false if the queue was full or there's no such sound, and the trigger was dropped
+     */
+    bool trigger(int32_t sound, int64_t timeNs);
+
+    /*!
+     * @return the number of voices playing, not counting stolen ones fading out. Only call this
+     * from the audio thread.
+     */
+    inline int32_t getVoiceCount() const { return (int32_t) voiceCount_; }
+
+    /*!
+     * Starts any queued sounds and mixes the next block. Untimed blocks start every sound on their
+     * first frame.
+     */
+    void render(float *outputBuffer, int32_t numFrames, int32_t numChannels, int64_t blockStartNs) override;
+
+    /*!
+     * Like the float version, but saturates the mix into signed 16-bit PCM, for a stream that
+     * plays 16-bit natively. Renders silence unless @a reservePcm16 was called.
+     */
+    void render(int16_t *outputBuffer, int32_t numFrames, int32_t numChannels, int64_t blockStartNs);
+
+private:
+
+    struct Voice {
+        int32_t sound;
+        int32_t cursor;
+
+        // Frames into the next block before the voice starts.
+        int32_t delay;
+
+        int32_t priority;
+        uint32_t age;
+        float gain;
+        float gainStep;
+    };
+
+    /*!
+     * @return the frame in a block starting at @a blockStartNs that a trigger at @a timeNs plays on
+     */
+    int32_t frameOffset(int64_t timeNs, int64_t blockStartNs, int32_t numFrames) const;
+
+    /*!
+     * Starts the sounds queued since the last render, on their frames of a block of @a numFrames.
+     */
+    void startTriggered(int32_t numFrames, int64_t blockStartNs);
+
+    /*!
+     * Mixes the next @a numFrames of every voice and the stream into @a outputBuffer, overwriting it.
+     */
+    void mixBlock(float *outputBuffer, int32_t numFrames, int32_t numChannels);
+
+    /*!
+     * Turns down any frame of the mix that would go over full scale, carrying the gain from one
+     * block to the next.
+     */
+    void limit(float *outputBuffer, int32_t numFrames, int32_t numChannels);
+
+    void startVoice(int32_t sound, float gain, int32_t delay);
+    void release(const Voice &voice);
+    bool mixVoice(Voice &voice, float *outputBuffer, int32_t numFrames, int32_t numChannels) const;
+
+    SpscQueue<SoundTrigger, 256> triggers_;
+    const SoundBank *bank_;
+    StreamPlayer *streamPlayer_;
+
+    // Triggers per sound drained this render and the earliest frame they start on, and which
+    // sounds those are, so only triggered sounds are visited. Counts are left at zero between renders.
+    std::array<int32_t, SoundBank::kMaxSounds> pending_;
+    std::array<int32_t, SoundBank::kMaxSounds> delays_;
+    std::array<int32_t, SoundBank::kMaxSounds> triggered_;
+
+    // The voice pool, with the active voices packed at the front.
+    std::vector<Voice> voices_;
+    size_t voiceCount_;
+
+    // Stolen voices that are still fading out.
+    std::vector<Voice> releasing_;
+    size_t releasingCount_;
+
+    // Where 16-bit blocks are mixed before they're converted.
+    std::vector<float> pcm16Mix_;
+
+    AudioStats *stats_;
+    int32_t sampleRate_;
+    uint32_t nextAge_;
+
+    // What the limiter is scaling the mix by, 1 when it isn't.
+    float limiterGain_;
+
+};
+
+#endif //PAT_PLAY_MIXER_H
@@ -2,7 +2,7 @@
 #define ANDROIDGLINVESTIGATIONS_MODEL_H
 
 #include <vector>
-#include "TextureAsset.h"
+#include "GpuResources.h"
 
 union Vector3 {
     struct {
@@ -36,10 +36,10 @@ public:
     inline Model(
             std::vector<Vertex> vertices,
             std::vector<Index> indices,
-            std::shared_ptr<TextureAsset> spTexture)
+            GpuHandle texture)
             : vertices_(std::move(vertices)),
               indices_(std::move(indices)),
-              spTexture_(std::move(spTexture)) {}
+              texture_(texture) {}
 
     inline const Vertex *getVertexData() const {
         return vertices_.data();
@@ -53,14 +53,14 @@ public:
         return indices_.data();
     }
 
-    inline const TextureAsset &getTexture() const {
-        return *spTexture_;
+    inline GpuHandle getTexture() const {
+        return texture_;
     }
 
 private:
     std::vector<Vertex> vertices_;
     std::vector<Index> indices_;
-    std::shared_ptr<TextureAsset> spTexture_;
+    GpuHandle texture_;
 };
 
 #endif //ANDROIDGLINVESTIGATIONS_MODEL_H
\ No newline at end of file
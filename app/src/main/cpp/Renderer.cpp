@@ -2,7 +2,9 @@
 
 #include <game-activity/native_app_glue/android_native_app_glue.h>
 #include <GLES3/gl3.h>
+#include <fstream>
 #include <memory>
+#include <string>
 #include <vector>
 #include <android/imagedecoder.h>
 
@@ -10,6 +12,7 @@
 #include "Shader.h"
 #include "Utility.h"
 #include "TextureAsset.h"
+#include "TextureCache.h"
 #include "Save.h"
 
 //! executes glGetString and outputs the result to logcat
@@ -55,6 +58,20 @@ inline float rand_vel() {
 }
 
 Renderer::~Renderer() {
+    // GL objects have to be deleted with the context current, which may have been released when
+    // the window went. If it can't be made current again, the names are forgotten instead and the
+    // objects go with the context.
+    auto current = display_ != EGL_NO_DISPLAY && context_ != EGL_NO_CONTEXT
+            && (surface_ != EGL_NO_SURFACE
+                ? eglMakeCurrent(display_, surface_, surface_, context_) == EGL_TRUE
+                : makeCurrentWithoutWindow());
+    if (!current) {
+        resources_.abandonAll();
+    }
+    shader_ = nullptr;
+    textures_.clear();
+    resources_.destroyAll();
+
     if (display_ != EGL_NO_DISPLAY) {
         eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         if (context_ != EGL_NO_CONTEXT) {
@@ -65,6 +82,10 @@ Renderer::~Renderer() {
             eglDestroySurface(display_, surface_);
             surface_ = EGL_NO_SURFACE;
         }
+        if (pbuffer_ != EGL_NO_SURFACE) {
+            eglDestroySurface(display_, pbuffer_);
+            pbuffer_ = EGL_NO_SURFACE;
+        }
         eglTerminate(display_);
         display_ = EGL_NO_DISPLAY;
     }
@@ -95,13 +116,13 @@ void Renderer::render() {
     bool setWhite = true;
     auto max_dim = fmax(w, h);
     shader_->setColor(1, 1, 1, 1);
-    shader_->setTexture(background_texture_->getTextureID());
+    shader_->setTexture(resources_.get(background_texture_));
     shader_->drawShape(w / 2, h / 2, max_dim, max_dim);
 
     // Render the regular pats.
     float scale = 48;
     if (!regular_pats_.empty() || !red_pats_.empty() || !mini_pats_.empty()) {
-        shader_->setTexture(regular_pat_texture_->getTextureID());
+        shader_->setTexture(resources_.get(regular_pat_texture_));
     }
     for (auto posTime : regular_pats_) {
         shader_->drawShape(posTime.pos.x, posTime.pos.y, scale * 2, scale * 2);
@@ -121,7 +142,7 @@ void Renderer::render() {
     if (!spring_pats_.empty()) {
         shader_->setColor(1, 1, 0.5, 1);
         setWhite = false;
-        shader_->setTexture(spring_pat_texture_->getTextureID());
+        shader_->setTexture(resources_.get(spring_pat_texture_));
         for (auto posTime : spring_pats_) {
             shader_->drawShape(posTime.pos.x, posTime.pos.y, scale * 3, scale * 3);
         }
@@ -136,20 +157,7 @@ void Renderer::render() {
             if (n == countStr[i]) {
                 if (!changedTexture) {
                     changedTexture = true;
-                    int tex = 0;
-                    switch (n) {
-                        case '0': tex = zero_texture_->getTextureID(); break;
-                        case '1': tex = one_texture_->getTextureID(); break;
-                        case '2': tex = two_texture_->getTextureID(); break;
-                        case '3': tex = three_texture_->getTextureID(); break;
-                        case '4': tex = four_texture_->getTextureID(); break;
-                        case '5': tex = five_texture_->getTextureID(); break;
-                        case '6': tex = six_texture_->getTextureID(); break;
-                        case '7': tex = seven_texture_->getTextureID(); break;
-                        case '8': tex = eight_texture_->getTextureID(); break;
-                        case '9': tex = nine_texture_->getTextureID(); break;
-                    }
-                    shader_->setTexture(tex);
+                    shader_->setTexture(resources_.get(digit_textures_[n - '0']));
                 }
                 if (!setWhite) {
                     setWhite = true;
@@ -161,8 +169,16 @@ void Renderer::render() {
     }
 
     // Present the rendered image. This is an implicit glFlush.
-    auto swapResult = eglSwapBuffers(display_, surface_);
-    assert(swapResult == EGL_TRUE);
+    // The context can be lost at any time (e.g. the GPU was reset), in which case everything in it
+    // has to be rebuilt before the next frame.
+    if (!eglSwapBuffers(display_, surface_)) {
+        auto error = eglGetError();
+        if (error == EGL_CONTEXT_LOST) {
+            recoverContext();
+        } else {
+            aout << "eglSwapBuffers failed: " << error << std::endl;
+        }
+    }
 }
 
 void Renderer::postRender() {
@@ -174,6 +190,18 @@ void Renderer::postRender() {
 
 }
 
+/*!
+ * Checks whether a sound's cooldown has run out, and restarts it if so.
+ * @return true if the sound should play
+ */
+static bool takeCooldown(float &cooldown, float seconds) {
+    if (cooldown > 0.0) {
+        return false;
+    }
+    cooldown = seconds;
+    return true;
+}
+
 void Renderer::update() {
 
     auto w = (float) width_;
@@ -260,12 +288,26 @@ void Renderer::update() {
             spring_pats_[i].pos.y = h;
             hit_edge = true;
         }
-        if (hit_edge) {
+        if (hit_edge && takeCooldown(springReboundSoundCooldown_, 0.08)) {
             sound_.playSpringRebound();
         }
     }
     spring_pats_.resize(last);
 
+    // Count down sound cooldowns.
+    for (auto *cooldown : { &patSoundCooldown_, &redPatSoundCooldown_, &explosionSoundCooldown_, &springPatSoundCooldown_, &springReboundSoundCooldown_ }) {
+        if (*cooldown > 0.0) {
+            *cooldown -= dt;
+        }
+    }
+
+    // Log how the audio callback is doing now and then.
+    timeUntilAudioLog_ -= dt;
+    if (timeUntilAudioLog_ <= 0.0) {
+        timeUntilAudioLog_ = kAudioLogInterval;
+        logAudioStats();
+    }
+
     // Decrement save timer.
     if (timeUntilSave_ > 0.0) {
         timeUntilSave_ -= dt;
@@ -286,22 +328,41 @@ void Renderer::increment_counter(int c) {
 
 }
 
+void Renderer::logAudioStats() {
+    auto stats = sound_.getStats();
+    aout << "Audio: " << stats.callbacks << " callbacks"
+         << ", p99 < " << stats.getPercentileNs(99.0) / 1000 << "us"
+         << ", max " << stats.maxCallbackNs / 1000 << "us"
+         << " of " << stats.deadlineNs / 1000 << "us"
+         << ", voices " << stats.activeVoices << " (peak " << stats.peakVoices << ")"
+         << ", dropped " << stats.droppedTriggers
+         << ", xruns " << stats.xRunCount
+         << ", " << (stats.outputFormat == SampleFormat::Int16 ? "I16" : "float")
+         << (stats.mmap ? " MMAP" : " legacy") << (stats.exclusive ? " exclusive" : " shared") << std::endl;
+}
+
 void Renderer::spawn_pat(float x, float y) {
     int pat = rand_pat();
     if (pat == RED_PAT) {
         red_pats_.emplace_back(x,  y, rand_vel(), rand_vel());
         increment_counter(1);
-        sound_.playRedPat();
+        if (takeCooldown(redPatSoundCooldown_, 0.03)) {
+            sound_.playRedPat();
+        }
     } else if (pat == SPRING_PAT) {
         spring_pats_.emplace_back(x,  y, rand_vel(), rand_vel());
         spring_pats_.emplace_back(x,  y, rand_vel(), rand_vel());
         spring_pats_.emplace_back(x,  y, rand_vel(), rand_vel());
         increment_counter(3);
-        sound_.playSpringPat();
+        if (takeCooldown(springPatSoundCooldown_, 0.03)) {
+            sound_.playSpringPat();
+        }
     } else {
         regular_pats_.emplace_back(x,  y, rand_vel(), rand_vel());
         increment_counter(1);
-        sound_.playRegularPat();
+        if (takeCooldown(patSoundCooldown_, 0.03)) {
+            sound_.playRegularPat();
+        }
     }
 }
 
@@ -312,7 +373,9 @@ void Renderer::spawn_mini_pats(float x, float y) {
         mini_pats_.emplace_back(x, y, rand_vel() * speed, rand_vel() * speed);
     }
     increment_counter(count);
-    sound_.playExplosion();
+    if (takeCooldown(explosionSoundCooldown_, 0.05)) {
+        sound_.playExplosion();
+    }
 }
 
 void Renderer::initRenderer() {
@@ -363,67 +426,174 @@ void Renderer::initRenderer() {
     aout << "Found " << numConfigs << " configs" << std::endl;
     aout << "Chose " << config << std::endl;
 
-    // create the proper window surface
-    EGLint format;
-    eglGetConfigAttrib(display, config, EGL_NATIVE_VISUAL_ID, &format);
-    EGLSurface surface = eglCreateWindowSurface(display, config, app_->window, nullptr);
-
-    // Create a GLES 3 context
-    EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
-    EGLContext context = eglCreateContext(display, config, nullptr, contextAttribs);
+    display_ = display;
+    config_ = config;
 
-    // get some window metrics
-    auto madeCurrent = eglMakeCurrent(display, surface, surface, context);
-    assert(madeCurrent);
+    // Textures are loaded from the packed bundle when there is one, falling back to the
+    // individual assets otherwise.
+    auto assetManager = app_->activity->assetManager;
+    bundle_.open(assetManager, "patplay.pak");
+    textures_.init(assetManager, &bundle_, &resources_);
 
-    display_ = display;
-    surface_ = surface;
-    context_ = context;
+    constexpr EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    pbuffer_ = eglCreatePbufferSurface(display_, config_, pbufferAttribs);
 
-    // make width and height invalid so it gets updated the first frame in @a updateRenderArea()
-    width_ = -1;
-    height_ = -1;
+    createSurface();
+    createContext();
 
     PRINT_GL_STRING(GL_VENDOR);
     PRINT_GL_STRING(GL_RENDERER);
     PRINT_GL_STRING(GL_VERSION);
     PRINT_GL_STRING_AS_LIST(GL_EXTENSIONS);
 
-    shader_ = std::unique_ptr<Shader>(Shader::loadShader());
+    // Load textures.
+    regular_pat_texture_ = textures_.acquire("jpg/pat.jpeg", 1);
+    spring_pat_texture_ = textures_.acquire("jpg/springpat.jpeg", 1);
+    background_texture_ = textures_.acquire("jpg/background.jpeg", 0);
+    const char *digitPaths[] = {
+            "png/zero.png", "png/one.png", "png/two.png", "png/three.png", "png/four.png",
+            "png/five.png", "png/six.png", "png/seven.png", "png/eight.png", "png/nine.png"
+    };
+    for (auto i = 0; i < digit_textures_.size(); i++) {
+        digit_textures_[i] = textures_.acquire(digitPaths[i], 2);
+    }
+    aout << "Textures resident: " << textures_.getBytesResident() << " bytes" << std::endl;
+
+    // Init timer by jigging it.
+    time_.get_dt();
+
+    // Init sound. Decoded sounds are kept in internal storage, so later launches don't decode again.
+    std::string dataPath(app_->activity->internalDataPath);
+    sound_.setCachePath(dataPath + "/sounds.cache");
+
+    // Record the session's audio for diagnosing clipping and glitches, when asked to by putting a
+    // file called record_session in the app's internal storage.
+    if (std::ifstream(dataPath + "/record_session").good()) {
+        sound_.setRecordingPath(dataPath + "/session.wav");
+    }
+    sound_.startAsync(assetManager, &bundle_);
+
+    // Init save.
+    save_.init(app_->activity->internalDataPath);
+
+}
+
+void Renderer::createContext() {
+
+    // Create a GLES 3 context
+    EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    context_ = eglCreateContext(display_, config_, nullptr, contextAttribs);
+
+    // get some window metrics
+    auto madeCurrent = eglMakeCurrent(display_, surface_, surface_, context_);
+    assert(madeCurrent);
+
+    shader_ = std::unique_ptr<Shader>(Shader::loadShader(resources_));
     assert(shader_);
 
     // Note: there's only one shader in this demo, so I'll activate it here. For a more complex game
     // you'll want to track the active shader and activate/deactivate it as necessary
     shader_->activate();
+    shaderNeedsNewProjectionMatrix_ = true;
 
     glClearColor(0, 0, 0, 1);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Load textures.
-    auto assetManager = app_->activity->assetManager;
-    regular_pat_texture_ = TextureAsset::loadAsset(assetManager, "jpg/pat.jpeg", 1);
-    spring_pat_texture_ = TextureAsset::loadAsset(assetManager, "jpg/springpat.jpeg", 1);
-    background_texture_ = TextureAsset::loadAsset(assetManager, "jpg/background.jpeg", 0);
-    zero_texture_ = TextureAsset::loadAsset(assetManager, "png/zero.png", 2);
-    one_texture_ = TextureAsset::loadAsset(assetManager, "png/one.png", 2);
-    two_texture_ = TextureAsset::loadAsset(assetManager, "png/two.png", 2);
-    three_texture_ = TextureAsset::loadAsset(assetManager, "png/three.png", 2);
-    four_texture_ = TextureAsset::loadAsset(assetManager, "png/four.png", 2);
-    five_texture_ = TextureAsset::loadAsset(assetManager, "png/five.png", 2);
-    six_texture_ = TextureAsset::loadAsset(assetManager, "png/six.png", 2);
-    seven_texture_ = TextureAsset::loadAsset(assetManager, "png/seven.png", 2);
-    eight_texture_ = TextureAsset::loadAsset(assetManager, "png/eight.png", 2);
-    nine_texture_ = TextureAsset::loadAsset(assetManager, "png/nine.png", 2);
+    // Bring back anything that was loaded in a previous context, under the same handles.
+    textures_.reloadAll();
 
-    // Init timer by jigging it.
+}
+
+void Renderer::recoverContext() {
+
+    aout << "EGL context lost, recreating it" << std::endl;
+
+    // The names went with the old context, so forget them rather than deleting them, or we could
+    // end up deleting objects with the same names in the new one.
+    resources_.abandonAll();
+    shader_ = nullptr;
+
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display_, context_);
+    context_ = EGL_NO_CONTEXT;
+
+    createContext();
+
+}
+
+void Renderer::createSurface() {
+
+    // create the proper window surface
+    surface_ = eglCreateWindowSurface(display_, config_, app_->window, nullptr);
+
+    // make width and height invalid so it gets updated the first frame in @a updateRenderArea()
+    width_ = -1;
+    height_ = -1;
+
+}
+
+bool Renderer::makeCurrentWithoutWindow() {
+    if (eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_)) {
+        return true;
+    }
+    if (pbuffer_ != EGL_NO_SURFACE && eglMakeCurrent(display_, pbuffer_, pbuffer_, context_)) {
+        return true;
+    }
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    return false;
+}
+
+void Renderer::initWindow() {
+
+    createSurface();
+
+    // The context may have been lost while we were in the background. Anything else is usually a
+    // bad surface, so try a new one once. If that fails too, go without a window until the next
+    // one rather than draw with no context current.
+    for (auto attempt = 0; !eglMakeCurrent(display_, surface_, surface_, context_); attempt++) {
+        auto error = eglGetError();
+        if (error == EGL_CONTEXT_LOST) {
+            recoverContext();
+            break;
+        }
+        aout << "Couldn't make the context current with the window, EGL error 0x" << std::hex << error << std::dec << std::endl;
+        if (surface_ != EGL_NO_SURFACE) {
+            eglDestroySurface(display_, surface_);
+            surface_ = EGL_NO_SURFACE;
+        }
+        if (attempt > 0) {
+            aout << "Not drawing until the next window" << std::endl;
+            makeCurrentWithoutWindow();
+            break;
+        }
+        createSurface();
+    }
+
+    sound_.resume();
+
+    // Don't count the time spent in the background.
     time_.get_dt();
 
-    // Init sound.
-    sound_.startAsync(assetManager);
+}
+
+void Renderer::terminateWindow() {
 
-    // Init save.
-    save_.init(app_->activity->internalDataPath);
+    // The context and everything in it is kept, current without the window if possible.
+    makeCurrentWithoutWindow();
+    if (surface_ != EGL_NO_SURFACE) {
+        eglDestroySurface(display_, surface_);
+        surface_ = EGL_NO_SURFACE;
+    }
+
+    sound_.pause();
+
+    // We might not come back, so don't wait for the save timer.
+    if (needsSave_ || timeUntilSave_ > 0.0) {
+        save_.savePatCount(app_->activity->internalDataPath);
+        needsSave_ = false;
+        timeUntilSave_ = 0.0;
+    }
 
 }
 
@@ -2,13 +2,17 @@
 #define ANDROIDGLINVESTIGATIONS_RENDERER_H
 
 #include <EGL/egl.h>
+#include <array>
 #include <memory>
 
+#include "AssetBundle.h"
+#include "GpuResources.h"
 #include "Model.h"
 #include "Shader.h"
 #include "Time.h"
 #include "Sound.h"
 #include "Save.h"
+#include "TextureCache.h"
 
 struct android_app;
 
@@ -29,17 +33,46 @@ public:
             app_(pApp),
             display_(EGL_NO_DISPLAY),
             surface_(EGL_NO_SURFACE),
+            pbuffer_(EGL_NO_SURFACE),
             context_(EGL_NO_CONTEXT),
+            config_(nullptr),
             width_(0),
             height_(0),
             shaderNeedsNewProjectionMatrix_(true),
             timeUntilSave_(0.0),
-            needsSave_(false) {
+            needsSave_(false),
+            patSoundCooldown_(0.0),
+            redPatSoundCooldown_(0.0),
+            explosionSoundCooldown_(0.0),
+            springPatSoundCooldown_(0.0),
+            springReboundSoundCooldown_(0.0),
+            timeUntilAudioLog_(kAudioLogInterval),
+            regular_pat_texture_(),
+            spring_pat_texture_(),
+            background_texture_(),
+            digit_textures_() {
         initRenderer();
     }
 
     virtual ~Renderer();
 
+    /*!
+     * Creates a surface for the app's new window. The context and everything loaded in it are kept
+     * from before, unless the context was lost while we had no window.
+     */
+    void initWindow();
+
+    /*!
+     * Destroys the surface for the app's window, which is about to go away. The display and context
+     * are kept, so nothing needs reloading when a window comes back.
+     */
+    void terminateWindow();
+
+    /*!
+     * @return true if there is a surface to render to
+     */
+    inline bool hasWindow() const { return surface_ != EGL_NO_SURFACE; }
+
     /*!
      * Handles input from the android_app.
      *
@@ -69,6 +102,29 @@ private:
      */
     void initRenderer();
 
+    /*!
+     * Creates the GL context, makes it current with the surface, and creates the objects that live
+     * in it. Textures are reloaded if the context is replacing one that was lost.
+     */
+    void createContext();
+
+    /*!
+     * Throws away a lost context, along with all the GL names from it, and builds a new one.
+     */
+    void recoverContext();
+
+    /*!
+     * Creates a surface for the app's current window.
+     */
+    void createSurface();
+
+    /*!
+     * Keeps the context current while there's no window, surfaceless if the driver supports it and
+     * on a 1x1 pbuffer otherwise, so GL objects can still be created and deleted.
+     * @return false if neither works, in which case the context has been released
+     */
+    bool makeCurrentWithoutWindow();
+
     /*!
      * @brief we have to check every frame to see if the framebuffer has changed in size. If it has,
      * update the viewport accordingly
@@ -87,15 +143,22 @@ private:
     void spawn_pat(float x, float y);
     void spawn_mini_pats(float x, float y);
     void increment_counter(int c);
+    void logAudioStats();
 
     Time time_;
+    AssetBundle bundle_;
     Sound sound_;
     Save save_;
 
     android_app *app_;
     EGLDisplay display_;
     EGLSurface surface_;
+
+    // Keeps the context current without a window, where surfaceless contexts aren't supported.
+    // Null if the config can't make one.
+    EGLSurface pbuffer_;
     EGLContext context_;
+    EGLConfig config_;
     EGLint width_;
     EGLint height_;
 
@@ -103,23 +166,30 @@ private:
     float timeUntilSave_;
     bool needsSave_;
 
+    // Seconds until each sound may be played again, so a burst of taps or bounces in quick
+    // succession doesn't pile up identical voices.
+    float patSoundCooldown_;
+    float redPatSoundCooldown_;
+    float explosionSoundCooldown_;
+    float springPatSoundCooldown_;
+    float springReboundSoundCooldown_;
+
+    // Seconds until the audio callback's counters are next logged.
+    static constexpr float kAudioLogInterval = 10.0;
+    float timeUntilAudioLog_;
+
+    // Declared before the texture cache, shader, models and texture handles, so it's destroyed
+    // after everything holding handles into it.
+    GpuResources resources_;
+    TextureCache textures_;
+
     std::unique_ptr<Shader> shader_;
     std::vector<Model> models_;
 
-    std::shared_ptr<TextureAsset> regular_pat_texture_;
-    std::shared_ptr<TextureAsset> spring_pat_texture_;
-    std::shared_ptr<TextureAsset> background_texture_;
-
-    std::shared_ptr<TextureAsset> zero_texture_;
-    std::shared_ptr<TextureAsset> one_texture_;
-    std::shared_ptr<TextureAsset> two_texture_;
-    std::shared_ptr<TextureAsset> three_texture_;
-    std::shared_ptr<TextureAsset> four_texture_;
-    std::shared_ptr<TextureAsset> five_texture_;
-    std::shared_ptr<TextureAsset> six_texture_;
-    std::shared_ptr<TextureAsset> seven_texture_;
-    std::shared_ptr<TextureAsset> eight_texture_;
-    std::shared_ptr<TextureAsset> nine_texture_;
+    GpuHandle regular_pat_texture_;
+    GpuHandle spring_pat_texture_;
+    GpuHandle background_texture_;
+    std::array<GpuHandle, 10> digit_textures_;
 
     std::vector<PositionAndTime> regular_pats_;
     std::vector<PositionAndTime> red_pats_;
@@ -0,0 +1,71 @@
+#ifndef PAT_PLAY_RESAMPLER_H
+#define PAT_PLAY_RESAMPLER_H
+
+#include <cstdint>
+#include <vector>
+
+/*!
+ * Polyphase windowed-sinc resampler for converting whole sounds between sample rates.
+ *
+ * The rate ratio is reduced to @a L / @a M, and each output frame is a dot product of @a taps input
+ * frames with one of @a L precomputed filter phases. The filter is a Kaiser windowed sinc with its
+ * cutoff just under the lower of the two Nyquist rates, so it both removes images when upsampling
+ * and stops aliasing when downsampling. Each phase is normalized to unity gain at DC.
+ *
+ * Odd rate pairs can have tens of thousands of phases. Those get a table of evenly spaced phases
+ * instead, and each output frame interpolates between the two phases either side of it.
+ *
+ * Meant for load time, it isn't tuned for the audio thread.
+ */
+class Resampler {
+public:
+
+    static constexpr int32_t kDefaultTaps = 64;
+
+    /*!
+     * @param inputRate Rate of the source
+     * @param outputRate Rate to convert to
+     * @param taps Input frames each output frame is built from, rounded up to an even number
+     */
+    Resampler(int32_t inputRate, int32_t outputRate, int32_t taps = kDefaultTaps);
+
+    /*!
+     * @return the number of output frames for @a inputFrames of input
+     */
+    int32_t getOutputFrames(int32_t inputFrames) const;
+
+    /*!
+     * Resamples interleaved audio. Frames before the start and after the end count as silence, and
+     * the output is aligned with the input, without any added delay.
+     * @param input Interleaved input frames
+     * @param inputFrames Frames in @a input
+     * @param numChannels Channels in the input and output
+     * @param output Space for @a getOutputFrames frames
+     */
+    void process(const float *input, int32_t inputFrames, int32_t numChannels, float *output) const;
+
+private:
+
+    /*!
+     * Fills in the filter phase for an output that lands @a fraction of the way between two input
+     * frames.
+     */
+    void makePhase(double fraction, float *coefficients) const;
+
+    int64_t L_;
+    int64_t M_;
+    int32_t taps_;
+    double cutoff_;
+
+    // Scales the Kaiser window to 1 at its centre.
+    double windowScale_;
+
+    // Phases of taps coefficients. Either all L of them, or, with @a interpolated_, one for every
+    // step of tableSteps_ between two input frames, and both ends.
+    std::vector<float> phases_;
+    int64_t tableSteps_;
+    bool interpolated_;
+
+};
+
+#endif //PAT_PLAY_RESAMPLER_H
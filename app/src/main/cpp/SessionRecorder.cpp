@@ -0,0 +1,185 @@
+#include "SessionRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "WaveHeader.h"
+
+// Samples the writer thread moves to the file at a time.
+static constexpr size_t kChunkSamples = 16384;
+
+// How often the writer thread empties the ring. The header is brought up to date each time, so
+// the file is readable even if the app is killed mid-session.
+static constexpr auto kFlushInterval = std::chrono::milliseconds(100);
+
+// Frames of 16-bit output widened to float at a time.
+static constexpr size_t kWidenFrames = 256;
+
+// Most sample bytes a WAV can hold, since RIFF sizes are 32-bit and include the header.
+static constexpr uint64_t kMaxDataBytes = UINT32_MAX - kMaxWaveHeaderBytes;
+
+// Scales 16-bit PCM to the -1 to 1 range of float samples.
+static constexpr float kPcm16Scale = 1.0f / 32768.0f;
+
+SessionRecorder::SessionRecorder(int32_t numChannels, int32_t sampleRate, int32_t bufferFrames):
+        numChannels_(numChannels),
+        sampleRate_(sampleRate),
+        ring_((size_t) bufferFrames * numChannels),
+        recording_(false),
+        droppedFrames_(0),
+        widened_(kWidenFrames * numChannels),
+        quit_(false),
+        file_(nullptr),
+        dataBytes_(0),
+        maxDataBytes_(kMaxDataBytes - kMaxDataBytes % (sizeof(float) * numChannels)),
+        chunk_(kChunkSamples) {}
+
+SessionRecorder::~SessionRecorder() {
+    stop();
+}
+
+bool SessionRecorder::start(const std::string &path) {
+
+    if (isRecording()) {
+        return false;
+    }
+
+    // A recording that filled its file has stopped taking samples, but its writer may still be
+    // around. Finish it first.
+    stop();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    dataBytes_ = 0;
+    if (!writeHeader()) {
+        fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    // The writer isn't running, so this thread can read the ring. Throw away whatever the last
+    // recording left behind after it stopped.
+    while (ring_.read(chunk_.data(), chunk_.size()) > 0) {}
+
+    quit_ = false;
+    droppedFrames_.store(0, std::memory_order_relaxed);
+    recording_.store(true, std::memory_order_release);
+    thread_ = std::thread(&SessionRecorder::write, this);
+    return true;
+
+}
+
+bool SessionRecorder::stop() {
+
+    if (!thread_.joinable()) {
+        return false;
+    }
+
+    // The writer empties the ring once more after this, so the last blocks make it in.
+    recording_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+
+    fclose(file_);
+    file_ = nullptr;
+    return true;
+
+}
+
+void SessionRecorder::record(const float *buffer, int32_t numFrames) {
+
+    if (!recording_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // Only whole frames go in, so the channels can't get out of step.
+    auto room = ring_.getWriteAvailable() / numChannels_;
+    auto frames = std::min((size_t) numFrames, room);
+    ring_.write(buffer, frames * numChannels_);
+    if (frames < (size_t) numFrames) {
+        droppedFrames_.store(droppedFrames_.load(std::memory_order_relaxed) + (uint32_t) (numFrames - frames), std::memory_order_relaxed);
+    }
+
+}
+
+void SessionRecorder::record(const int16_t *buffer, int32_t numFrames) {
+
+    if (!recording_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    auto room = ring_.getWriteAvailable() / numChannels_;
+    auto frames = std::min((size_t) numFrames, room);
+    for (size_t done = 0; done < frames;) {
+        auto count = std::min(frames - done, kWidenFrames);
+        auto source = buffer + done * numChannels_;
+        for (size_t i = 0; i < count * numChannels_; i++) {
+            widened_[i] = (float) source[i] * kPcm16Scale;
+        }
+        ring_.write(widened_.data(), count * numChannels_);
+        done += count;
+    }
+    if (frames < (size_t) numFrames) {
+        droppedFrames_.store(droppedFrames_.load(std::memory_order_relaxed) + (uint32_t) (numFrames - frames), std::memory_order_relaxed);
+    }
+
+}
+
+void SessionRecorder::write() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+
+        // Check before emptying the ring, so nothing recorded before a stop is left behind.
+        auto quit = quit_;
+        lock.unlock();
+
+        // Android is little endian, so the floats go out as they are. Once the file is as big as
+        // a WAV can be, the recording stops taking samples and the rest of the ring is thrown away.
+        auto written = false;
+        size_t count;
+        while ((count = ring_.read(chunk_.data(), chunk_.size())) > 0) {
+            auto room = (size_t) ((maxDataBytes_ - dataBytes_) / sizeof(float));
+            if (count >= room) {
+                recording_.store(false, std::memory_order_release);
+                count = room;
+            }
+            auto bytes = fwrite(chunk_.data(), sizeof(float), count, file_) * sizeof(float);
+            dataBytes_ += bytes;
+            written = written || bytes > 0;
+        }
+        if (written) {
+            writeHeader();
+            fseek(file_, 0, SEEK_END);
+            fflush(file_);
+        }
+
+        lock.lock();
+        if (quit) {
+            break;
+        }
+        wake_.wait_for(lock, kFlushInterval, [this]() { return quit_; });
+
+    }
+
+}
+
+bool SessionRecorder::writeHeader() {
+
+    WaveHeader header {};
+    header.audioFormat = 3;
+    header.numChannels = numChannels_;
+    header.sampleRate = sampleRate_;
+    header.bitDepth = 32;
+    header.dataSize = (size_t) dataBytes_;
+
+    uint8_t bytes[kMaxWaveHeaderBytes];
+    auto size = writeWaveHeader(header, bytes);
+    return fseek(file_, 0, SEEK_SET) == 0 && fwrite(bytes, 1, size, file_) == size;
+
+}
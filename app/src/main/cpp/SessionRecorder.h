@@ -0,0 +1,116 @@
+#ifndef PAT_PLAY_SESSIONRECORDER_H
+#define PAT_PLAY_SESSIONRECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+
+/*!
+ * Records exactly what the audio callback produced to a WAV file, for looking into clipping and
+ * glitches after a session.
+ *
+ * The audio callback only copies each block into a ring buffer, which is allocated up front, so
+ * recording never allocates, locks or touches the file on the audio thread. A writer thread
+ * empties the ring to the file in bulk. Samples are kept as 32-bit floats, so anything the mix
+ * took over full scale is still there to see.
+ */
+class SessionRecorder {
+public:
+
+    // Over a second at 48kHz, far longer than the writer ever sleeps.
+    static constexpr int32_t kDefaultBufferFrames = 65536;
+
+    /*!
+     * @param numChannels Channels of the output
+     * @param sampleRate Rate of the output
+     * @param bufferFrames Frames held for the writer thread
+     */
+    SessionRecorder(int32_t numChannels, int32_t sampleRate, int32_t bufferFrames = kDefaultBufferFrames);
+
+    ~SessionRecorder();
+
+    /*!
+     * Starts recording to a new file, replacing any file already there. Safe from any thread but
+     * the audio one.
+     * @return false if already recording or the file can't be created
+     */
+    bool start(const std::string &path);
+
+    /*!
+     * Stops recording and finishes the file. Safe from any thread but the audio one.
+     * @return false if there was no recording to stop
+     */
+    bool stop();
+
+    /*!
+     * @return whether samples are being taken. A recording stops taking them by itself once its
+     * file holds as much as a WAV can, though the file is only finished by @a stop.
+     */
+    inline bool isRecording() const { return recording_.load(std::memory_order_acquire); }
+
+    /*!
+     * Copies a block of output for the writer thread, if recording. Only call this from the audio
+     * thread. Never blocks.
+     */
+    void record(const float *buffer, int32_t numFrames);
+
+    /*!
+     * Like the float version, for a stream that plays 16-bit PCM. The samples are widened to float
+     * as they're copied.
+     */
+    void record(const int16_t *buffer, int32_t numFrames);
+
+    /*!
+     * @return frames left out of the recording because the writer fell behind
+     */
+    inline uint32_t getDroppedFrames() const { return droppedFrames_.load(std::memory_order_relaxed); }
+
+private:
+
+    /*!
+     * Empties the ring to the file until told to quit. Runs on the writer thread.
+     */
+    void write();
+
+    /*!
+     * Writes the WAV header for @a dataBytes_ of samples at the start of the file.
+     */
+    bool writeHeader();
+
+    int32_t numChannels_;
+    int32_t sampleRate_;
+
+    // Blocks of output, in the output's channel count.
+    SpscRing<float> ring_;
+
+    std::atomic<bool> recording_;
+    std::atomic<uint32_t> droppedFrames_;
+
+    // Used by the audio thread only, to widen 16-bit blocks.
+    std::vector<float> widened_;
+
+    // Tells the writer thread to finish.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool quit_;
+
+    // Used by the writer thread only while it runs.
+    FILE *file_;
+    uint64_t dataBytes_;
+
+    // Whole frames that fit under the 4GiB RIFF limit.
+    uint64_t maxDataBytes_;
+    std::vector<float> chunk_;
+
+    std::thread thread_;
+
+};
+
+#endif //PAT_PLAY_SESSIONRECORDER_H
@@ -36,7 +36,7 @@ void main() {
 }
 )fragment";
 
-Shader *Shader::loadShader() {
+Shader *Shader::loadShader(GpuResources &resources) {
     Shader *shader = nullptr;
 
     // Load vertex shader.
@@ -128,13 +128,14 @@ Shader *Shader::loadShader() {
 
                 // Construct shader.
                 shader = new Shader(
-                        program,
+                        resources,
+                        resources.add(GpuResourceKind::Program, program),
                         positionAttribute,
                         uvAttribute,
                         posSizeUniform,
                         projectionMatrixUniform,
                         colorUniform,
-                        vao);
+                        resources.add(GpuResourceKind::VertexArray, vao));
             } else {
                 glDeleteProgram(program);
             }
@@ -180,8 +181,8 @@ GLuint Shader::loadShader(GLenum shaderType, const std::string &shaderSource) {
 }
 
 void Shader::activate() const {
-    glUseProgram(program_);
-    glBindVertexArray(vao_);
+    glUseProgram(resources_.get(program_));
+    glBindVertexArray(resources_.get(vao_));
     glActiveTexture(GL_TEXTURE0);
     glEnableVertexAttribArray(position_);
     glEnableVertexAttribArray(uv_);
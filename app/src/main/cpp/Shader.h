@@ -4,6 +4,8 @@
 #include <string>
 #include <GLES3/gl3.h>
 
+#include "GpuResources.h"
+
 class Model;
 
 /*!
@@ -17,20 +19,15 @@ class Shader {
 public:
     /*!
      * Loads a shader.
+     * @param resources Registry that will own the program and vertex array
      * @return a valid Shader on success, otherwise null.
      */
-    static Shader *loadShader();
+    static Shader *loadShader(GpuResources &resources);
 
     inline ~Shader() {
         deactivate();  // We deactivate as there is only one shader.
-        if (program_) {
-            glDeleteProgram(program_);
-            program_ = 0;
-        }
-        if (vao_) {
-            glDeleteVertexArrays(1, &vao_);
-            vao_ = 0;
-        }
+        resources_.destroy(program_);
+        resources_.destroy(vao_);
     }
 
     /*!
@@ -75,20 +72,23 @@ private:
 
     /*!
      * Constructs a new instance of a shader. Use @a loadShader
-     * @param program the GL program id of the shader
+     * @param resources the registry owning the program and vertex array
+     * @param program the GL program of the shader
      * @param position the attribute location of the position
      * @param uv the attribute location of the uv coordinates
      * @param projectionMatrix the uniform location of the projection matrix
      */
     constexpr Shader(
-            GLuint program,
+            GpuResources &resources,
+            GpuHandle program,
             GLint position,
             GLint uv,
             GLint posSize,
             GLint projectionMatrix,
             GLint color,
-            GLuint vao)
-            : program_(program),
+            GpuHandle vao)
+            : resources_(resources),
+              program_(program),
               position_(position),
               posSize_(posSize),
               uv_(uv),
@@ -97,13 +97,14 @@ private:
               vao_(vao),
               lastTex_(0) {}
 
-    GLuint program_;
+    GpuResources &resources_;
+    GpuHandle program_;
     GLint position_;
     GLint uv_;
     GLint posSize_;
     GLint projectionMatrix_;
     GLint color_;
-    GLuint vao_;
+    GpuHandle vao_;
     GLuint lastTex_;
 };
 
@@ -4,54 +4,275 @@
 
 #include "Sound.h"
 
+#include <algorithm>
+#include <chrono>
 #include <future>
 
 #include <android/asset_manager.h>
 
 #include "AudioFile.h"
 #include "AndroidOut.h"
+#include "Resampler.h"
+#include "Time.h"
+#include "WaveHeader.h"
+
+// Lists every sound, see SoundBank for the format.
+static constexpr const char *kSoundManifestPath = "sounds.txt";
+
+// The app's version code, passed in by the build. Cached sounds from another version are ignored.
+#ifndef PAT_PLAY_VERSION_CODE
+#define PAT_PLAY_VERSION_CODE 0
+#endif
+
+// Whether the cache key hashes every byte of every sound. A release's version code already says
+// which sounds shipped, so only the sounds' lengths and headers are hashed. Without one, a build
+// can change a sound in place, and reading all of them on each launch is what catches it.
+static constexpr bool kHashSoundContents = PAT_PLAY_VERSION_CODE == 0;
+
+// How many times to try reopening a disconnected stream, and how long to wait before the second
+// try. The wait doubles after each one, since the new device is usually a moment from ready.
+static constexpr int kMaxReopenAttempts = 5;
+static constexpr std::chrono::milliseconds kFirstReopenDelay(100);
+
+/*!
+ * Reads a WAV for a @a WaveStream out of an asset, a piece at a time.
+ */
+class AssetWaveSource: public WaveSource {
+public:
+
+    inline explicit AssetWaveSource(AAsset *asset): asset_(asset) {}
+
+    inline ~AssetWaveSource() override {
+        AAsset_close(asset_);
+    }
+
+    size_t read(void *buffer, size_t size) override {
+        auto read = AAsset_read(asset_, buffer, size);
+        return read > 0 ? (size_t) read : 0;
+    }
+
+    bool seek(size_t offset) override {
+        return AAsset_seek64(asset_, (off64_t) offset, SEEK_SET) == (off64_t) offset;
+    }
+
+private:
+    AAsset *asset_;
+};
 
-std::unique_ptr<AudioFile<float>> loadSoundFile(AAssetManager *assetManager, const std::string &assetPath) {
+SoundBuffer decodeSoundFile(AAssetManager *assetManager, const AssetBundle *bundle, const std::string &assetPath, int32_t numChannels, SampleFormat format) {
 
-    // Try and open asset.
-    AAsset *asset = AAssetManager_open(assetManager, assetPath.c_str(), AASSET_MODE_UNKNOWN);
+    // Prefer the bundle, which already holds the PCM data without any WAV parsing needed.
+    if (bundle && bundle->isOpen()) {
+        auto entry = bundle->find(assetPath, BundleEntryKind::Sound);
+        if (entry && entry->width > 0) {
+            auto pcm = reinterpret_cast<const int16_t *>(bundle->getData(*entry));
+            auto sourceChannels = (int32_t) entry->width;
+            auto numFrames = (int32_t) (entry->size / (sizeof(int16_t) * sourceChannels));
+            return SoundBuffer::fromInterleaved(pcm, numFrames, sourceChannels, numChannels, (int32_t) entry->height, format);
+        }
+    }
+
+    // Try and open asset. Asking for its whole buffer lets an uncompressed asset be mapped
+    // straight out of the APK.
+    AAsset *asset = AAssetManager_open(assetManager, assetPath.c_str(), AASSET_MODE_BUFFER);
     if (!asset) {
         aout << "Failed to open asset " << assetPath << std::endl;
-        return nullptr;
+        return {};
     }
 
     // Get file data.
     auto data = AAsset_getBuffer(asset);
     auto size = AAsset_getLength(asset);
 
-    // Copy into audio file.
-    std::vector<uint8_t> data_in_vec((uint8_t*)data, (uint8_t*)data + size);
-    auto audioFile = std::make_unique<AudioFile<float>>();
-    audioFile->loadFromMemory(data_in_vec);
+    // 16-bit PCM is already laid out like a bundled sound, so it's copied straight from the asset's
+    // buffer without going through float.
+    WaveHeader header {};
+    auto bytes = static_cast<const uint8_t *>(data);
+    if (bytes && parseWaveHeader(bytes, (size_t) size, header) && header.audioFormat == 1 && header.bitDepth == 16
+            && reinterpret_cast<uintptr_t>(bytes + header.dataOffset) % alignof(int16_t) == 0) {
+        auto available = std::min(header.dataSize, (size_t) size - std::min(header.dataOffset, (size_t) size));
+        auto numFrames = (int32_t) (available / header.getBytesPerFrame());
+        auto pcm = reinterpret_cast<const int16_t *>(bytes + header.dataOffset);
+        auto buffer = SoundBuffer::fromInterleaved(pcm, numFrames, header.numChannels, numChannels, header.sampleRate, format);
+        AAsset_close(asset);
+        return buffer;
+    }
+
+    // Anything else is decoded in place from the asset's buffer, then laid out the way the mixer
+    // wants it.
+    AudioFile<float> audioFile;
+    audioFile.loadFromMemory(static_cast<const uint8_t *>(data), (size_t) size);
     AAsset_close(asset);
 
-    return audioFile;
+    return SoundBuffer::fromPlanar(audioFile.samples, numChannels, (int32_t) audioFile.getSampleRate(), format);
+
+}
+
+int32_t measureSoundFile(AAssetManager *assetManager, const AssetBundle *bundle, const std::string &assetPath, int32_t sampleRate, uint64_t &contentHash) {
+
+    // Read the length and rate from the bundle entry or the WAV header, without decoding anything.
+    // The entry or header goes into the hash, or all the source bytes when there's no version code.
+    int32_t numFrames = 0;
+    int32_t sourceRate = 0;
+    auto entry = bundle && bundle->isOpen() ? bundle->find(assetPath, BundleEntryKind::Sound) : nullptr;
+    if (entry && entry->width > 0) {
+        numFrames = (int32_t) (entry->size / (sizeof(int16_t) * entry->width));
+        sourceRate = (int32_t) entry->height;
+        contentHash = kHashSoundContents
+                ? SoundCache::hashBytes(contentHash, bundle->getData(*entry), entry->size)
+                : SoundCache::hashBytes(contentHash, entry, sizeof(*entry));
+    } else {
+        AAsset *asset = AAssetManager_open(assetManager, assetPath.c_str(), AASSET_MODE_BUFFER);
+        if (!asset) {
+            return 0;
+        }
+        WaveHeader header {};
+        auto data = static_cast<const uint8_t *>(AAsset_getBuffer(asset));
+        auto size = (size_t) AAsset_getLength(asset);
+        if (data && parseWaveHeader(data, size, header)) {
+            numFrames = header.getNumFrames();
+            sourceRate = header.sampleRate;
+            if (kHashSoundContents) {
+                contentHash = SoundCache::hashBytes(contentHash, data, size);
+            } else {
+                contentHash = SoundCache::hashBytes(contentHash, &size, sizeof(size));
+                contentHash = SoundCache::hashBytes(contentHash, data, header.dataOffset);
+            }
+        }
+        AAsset_close(asset);
+    }
+
+    // Loading resamples anything at another rate, which changes the length.
+    if (numFrames <= 0 || sourceRate == sampleRate) {
+        return numFrames;
+    }
+    return Resampler(sourceRate, sampleRate).getOutputFrames(numFrames);
+
+}
+
+SoundBuffer loadSoundFile(AAssetManager *assetManager, const AssetBundle *bundle, const std::string &assetPath, int32_t numChannels, int32_t sampleRate, SampleFormat format) {
+
+    auto buffer = decodeSoundFile(assetManager, bundle, assetPath, numChannels, format);
+    if (buffer.isEmpty() || buffer.getSampleRate() == sampleRate) {
+        return buffer;
+    }
+    return buffer.resampledTo(sampleRate);
+
+}
+
+Sound::Sound():
+        assetManager_(nullptr),
+        bundle_(nullptr),
+        sampleFormat_(SampleFormat::Int16),
+        scheduleDelayNs_(0),
+        errorCallback_(std::make_shared<ErrorCallback>(this)),
+        numChannels_(0),
+        sampleRate_(0),
+        paused_(false),
+        stopped_(false),
+        patGroup_(SoundBank::kNoSound),
+        redPatGroup_(SoundBank::kNoSound),
+        explosionGroup_(SoundBank::kNoSound),
+        springPatGroup_(SoundBank::kNoSound),
+        springReboundGroup_(SoundBank::kNoSound),
+        activeRecorder_(nullptr) {
+    mixer_.setStats(&stats_);
+    mixer_.setBank(&bank_);
+}
+
+Sound::~Sound() {
+
+    stop();
+
+    // The decodes write into the mixer, so they have to finish before it goes away.
+    if (asyncResult_.valid()) {
+        asyncResult_.wait();
+    }
+    if (soundsResult_.valid()) {
+        soundsResult_.wait();
+    }
+    for (auto &result : loadResults_) {
+        result.wait();
+    }
+    if (cacheResult_.valid()) {
+        cacheResult_.wait();
+    }
+
+    // Oboe's error thread may be about to call in, or already in a callback starting a restart.
+    // Once detached, nothing can start another, so the restart below is the last.
+    errorCallback_->detach();
+    std::future<void> restartResult;
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        restartResult = std::move(restartResult_);
+    }
+    if (restartResult.valid()) {
+        restartResult.wait();
+    }
+
+}
+
+void Sound::setSampleFormat(SampleFormat format) {
+    sampleFormat_ = format;
+}
 
+void Sound::setCachePath(const std::string &path) {
+    cachePath_ = path;
 }
 
-void Sound::startAsync(AAssetManager *assetManager) {
+void Sound::setRecordingPath(const std::string &path) {
+    recordingPath_ = path;
+}
+
+void Sound::startAsync(AAssetManager *assetManager, const AssetBundle *bundle) {
     assetManager_ = assetManager;
+    bundle_ = bundle;
+
+    // The manifest is tiny, so it's read here and the game can ask for groups straight away.
+    loadManifest(assetManager);
     asyncResult_ = std::async(&Sound::start, this);
 }
 
 void Sound::start() {
-    if (openStream()) {
-        loadSounds(assetManager_);
-        oboe::Result result = mAudioStream->requestStart();
-        if (result != oboe::Result::OK) {
-            aout << "Failed to start audio" << std::endl;
-        }
+
+    // Opened before taking the lock, which can take a while, so nothing waits on it.
+    auto stream = openStream(0);
+    if (!stream) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(streamMutex_);
+    if (stopped_) {
+        stream->close();
+        return;
+    }
+    mAudioStream = stream;
+
+    // Start straight away and load behind it. Sounds that aren't ready yet are just silent.
+    numChannels_ = mAudioStream->getChannelCount();
+    sampleRate_ = mAudioStream->getSampleRate();
+    mixer_.setSampleRate(sampleRate_);
+    streamPlayer_ = std::make_unique<StreamPlayer>(numChannels_, sampleRate_);
+    mixer_.setStreamPlayer(streamPlayer_.get());
+    if (!recordingPath_.empty()) {
+        beginRecording(recordingPath_);
     }
-    assetManager_ = nullptr;
+    oboe::Result result = mAudioStream->requestStart();
+    if (result != oboe::Result::OK) {
+        aout << "Failed to start audio" << std::endl;
+    }
+    auto numChannels = numChannels_;
+    auto sampleRate = sampleRate_;
+    lock.unlock();
+
+    soundsResult_ = std::async(std::launch::async, &Sound::loadSounds, this, assetManager_, numChannels, sampleRate);
+
 }
 
 void Sound::stop() {
 
+    std::lock_guard<std::mutex> lock(streamMutex_);
+    stopped_ = true;
+
     if (mAudioStream) {
         mAudioStream->stop();
         mAudioStream->close();
@@ -59,78 +280,267 @@ void Sound::stop() {
 
     mAudioStream = nullptr;
 
+    // Wakes a restart waiting to try again.
+    streamCondition_.notify_all();
+
 }
 
-bool Sound::openStream() {
+void Sound::pause() {
+
+    // The stream is opened by the start task, so let it finish first.
+    if (asyncResult_.valid()) {
+        asyncResult_.wait();
+    }
+
+    std::lock_guard<std::mutex> lock(streamMutex_);
+    paused_ = true;
+    if (mAudioStream) {
+        mAudioStream->requestPause();
+    }
+
+}
+
+void Sound::resume() {
+
+    if (asyncResult_.valid()) {
+        asyncResult_.wait();
+    }
+
+    std::lock_guard<std::mutex> lock(streamMutex_);
+    paused_ = false;
+    if (mAudioStream) {
+        mAudioStream->requestStart();
+    }
+
+}
+
+void Sound::ErrorCallback::detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sound_ = nullptr;
+}
+
+void Sound::ErrorCallback::onErrorAfterClose(oboe::AudioStream *oboeStream, oboe::Result error) {
+
+    // Held for the whole call, so detaching waits for it to return.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sound_) {
+        sound_->onStreamError(oboeStream, error);
+    }
+
+}
+
+void Sound::onStreamError(oboe::AudioStream *oboeStream, oboe::Result error) {
+
+    aout << "Audio stream closed after error " << convertToText(error) << std::endl;
+    if (error != oboe::Result::ErrorDisconnected) {
+        return;
+    }
+
+    // Reopen on a worker rather than hold up Oboe's error thread. A stream that's been replaced
+    // or stopped on purpose is left alone.
+    std::future<void> lastRestart;
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        if (stopped_ || oboeStream != mAudioStream.get()) {
+            return;
+        }
+        lastRestart = std::move(restartResult_);
+        restartResult_ = std::async(std::launch::async, &Sound::restart, this);
+    }
+
+    // The last restart opened the stream that just failed, so all it has left is to return. It's
+    // waited for outside the lock, which it may still be holding.
+    if (lastRestart.valid()) {
+        lastRestart.wait();
+    }
+
+}
+
+void Sound::restart() {
+
+    auto startNs = nowNanos();
+    auto delay = kFirstReopenDelay;
+    for (int attempt = 1; ; attempt++) {
+
+        // Ask for the rate and channel count the sounds were loaded for, with Oboe converting if
+        // the new device differs, rather than every sound having to be loaded again.
+        auto stream = openStream(sampleRate_);
+        if (stream && (stream->getChannelCount() != numChannels_ || stream->getSampleRate() != sampleRate_)) {
+            aout << "Reopened stream plays " << stream->getChannelCount() << " channels at " << stream->getSampleRate()
+                 << "Hz, but the sounds are " << numChannels_ << " channels at " << sampleRate_ << "Hz" << std::endl;
+            stream->close();
+            stream = nullptr;
+        }
+
+        std::unique_lock<std::mutex> lock(streamMutex_);
+        if (stopped_) {
+            if (stream) {
+                stream->close();
+            }
+            return;
+        }
+        if (stream) {
+            mAudioStream = stream;
+
+            // The new device has its own latency, so the schedule is worked out again. Nothing is
+            // rendering yet, so the callback's state can be touched here.
+            scheduleDelayNs_ = 0;
+            if (!paused_ && mAudioStream->requestStart() != oboe::Result::OK) {
+                aout << "Failed to restart audio" << std::endl;
+                return;
+            }
+            aout << "Audio stream reopened in " << (nowNanos() - startNs) / 1000 << "us" << std::endl;
+            return;
+        }
+        if (attempt == kMaxReopenAttempts) {
+            aout << "Gave up reopening the audio stream after " << attempt << " tries, sound is off until the app restarts" << std::endl;
+            return;
+        }
+
+        // Waits without the lock, and wakes early if the sound is stopped.
+        streamCondition_.wait_for(lock, delay, [this] { return stopped_; });
+        delay *= 2;
+    }
+
+}
+
+std::shared_ptr<oboe::AudioStream> Sound::openStream(int32_t sampleRate) {
 
     // Build the stream.
 
     oboe::AudioStreamBuilder builder;
-    builder.setFormat(oboe::AudioFormat::Float);
-    builder.setFormatConversionAllowed(true);
+    // No format is asked for, so the stream opens in the device's own. If Oboe had to convert,
+    // it could take the stream off the MMAP path.
+    builder.setFormat(oboe::AudioFormat::Unspecified);
+    builder.setFormatConversionAllowed(false);
     builder.setPerformanceMode(oboe::PerformanceMode::LowLatency);
     builder.setSharingMode(oboe::SharingMode::Exclusive);
-    builder.setSampleRate(44100);
-    builder.setSampleRateConversionQuality(oboe::SampleRateConversionQuality::Medium);
+    // No sample rate is asked for at first, so the stream opens at the device's native rate and
+    // nothing resamples the mix on the audio thread. Sounds are converted to match when they're
+    // loaded. A reopened stream asks for the rate the sounds were loaded at instead. Oboe only
+    // resamples if given a quality, so a device at another rate would otherwise open at its own.
+    if (sampleRate > 0) {
+        builder.setSampleRate(sampleRate);
+        builder.setSampleRateConversionQuality(oboe::SampleRateConversionQuality::Medium);
+        builder.setChannelConversionAllowed(true);
+    }
     builder.setChannelCount(2);
     builder.setDataCallback(this);
+    builder.setErrorCallback(errorCallback_);
+
+    std::shared_ptr<oboe::AudioStream> stream;
+    oboe::Result result = builder.openStream(stream);
 
-    oboe::Result result = builder.openStream(mAudioStream);
+    // The mixer writes float or 16-bit PCM. For anything else, let Oboe convert from float.
+    if (result == oboe::Result::OK && stream->getFormat() != oboe::AudioFormat::Float && stream->getFormat() != oboe::AudioFormat::I16) {
+        aout << "Stream opened as " << convertToText(stream->getFormat()) << ", converting from float" << std::endl;
+        stream->close();
+        result = oboe::Result::ErrorInvalidFormat;
+    }
+    if (result != oboe::Result::OK) {
+        builder.setFormat(oboe::AudioFormat::Float);
+        builder.setFormatConversionAllowed(true);
+        result = builder.openStream(stream);
+    }
     if (result != oboe::Result::OK) {
         aout << "Failed to open stream. Error: " << convertToText(result) << std::endl;
-        return false;
+        return nullptr;
     }
 
-    mAudioStream->setDelayBeforeCloseMillis(500);
+    stream->setDelayBeforeCloseMillis(500);
 
-    return true;
+    auto outputFormat = stream->getFormat() == oboe::AudioFormat::I16 ? SampleFormat::Int16 : SampleFormat::Float;
+    auto mmapUsed = oboe::OboeExtensions::isMMapUsed(stream.get());
+    auto exclusive = stream->getSharingMode() == oboe::SharingMode::Exclusive;
+    stats_.setStreamInfo(outputFormat, mmapUsed, exclusive);
+    aout << "Opened " << convertToText(stream->getFormat()) << " stream at " << stream->getSampleRate() << "Hz"
+         << (mmapUsed ? ", MMAP" : ", legacy") << (exclusive ? ", exclusive" : ", shared") << std::endl;
+
+    if (outputFormat == SampleFormat::Int16) {
+        mixer_.reservePcm16(stream->getBufferCapacityInFrames(), stream->getChannelCount());
+    }
+
+    return stream;
 }
 
-bool Sound::loadSounds(AAssetManager *assetManager) {
+void Sound::loadManifest(AAssetManager *assetManager) {
 
-    regularPatSound_ = loadSoundFile(assetManager, "wav/pat.wav");
-    redPatSound_ = loadSoundFile(assetManager, "wav/redpat.wav");
-    explosionSound_ = loadSoundFile(assetManager, "wav/explode.wav");
-    springSoundOne_ = loadSoundFile(assetManager, "wav/springypat1.wav");
-    springSoundTwo_ = loadSoundFile(assetManager, "wav/springypat2.wav");
-    springSoundThree_ = loadSoundFile(assetManager, "wav/springypat3.wav");
-    springReboundSoundOne_ = loadSoundFile(assetManager, "wav/spring1.wav");
-    springReboundSoundTwo_ = loadSoundFile(assetManager, "wav/spring2.wav");
-    springReboundSoundThree_ = loadSoundFile(assetManager, "wav/spring3.wav");
+    AAsset *asset = AAssetManager_open(assetManager, kSoundManifestPath, AASSET_MODE_BUFFER);
+    if (!asset) {
+        aout << "Failed to open sound manifest " << kSoundManifestPath << std::endl;
+        return;
+    }
+    auto text = static_cast<const char *>(AAsset_getBuffer(asset));
+    if (!text || !bank_.parseManifest(text, (size_t) AAsset_getLength(asset))) {
+        aout << "Failed to read sound manifest " << kSoundManifestPath << std::endl;
+    }
+    AAsset_close(asset);
 
-    return true;
+    patGroup_ = bank_.findGroup("pat");
+    redPatGroup_ = bank_.findGroup("redpat");
+    explosionGroup_ = bank_.findGroup("explosion");
+    springPatGroup_ = bank_.findGroup("springpat");
+    springReboundGroup_ = bank_.findGroup("rebound");
 
 }
 
-void playSoundArray(float* outputBuffer, AudioFile<float>* audioFile, std::vector<int32_t> &cursors, int numChannels, int numFrames) {
+void Sound::loadSounds(AAssetManager *assetManager, int32_t numChannels, int32_t sampleRate) {
+
+    // Sounds are stored in the stream's channel layout and rate, so the callback doesn't convert anything.
+    auto startNs = nowNanos();
+
+    // Measure every sound first, so the bank can be laid out in one block before anything decodes.
+    std::vector<int32_t> numFrames;
+    auto contentHash = SoundCache::kEmptyHash;
+    for (int32_t sound = 0; sound < bank_.getSoundCount(); sound++) {
+        numFrames.push_back(measureSoundFile(assetManager, bundle_, bank_.getEntry(sound).path, sampleRate, contentHash));
+    }
+
+    // Play straight from the cache if it was made for these sounds and this stream.
+    SoundCacheKey key { PAT_PLAY_VERSION_CODE, SoundCache::hashManifest(bank_), contentHash, sampleFormat_, numChannels, sampleRate };
+    if (!cachePath_.empty() && cache_.map(cachePath_, key, numFrames)) {
+        if (bank_.attach(sampleFormat_, numChannels, sampleRate, numFrames, cache_.getSamples(), cache_.getByteSize())) {
+            aout << "Sounds mapped from cache in " << (nowNanos() - startNs) / 1000 << "us" << std::endl;
+            return;
+        }
+        cache_.unmap();
+    }
 
-    auto channelCount = audioFile->getNumChannels();
-    if (channelCount > numChannels) {
+    if (!bank_.allocate(sampleFormat_, numChannels, sampleRate, numFrames)) {
+        aout << "Failed to allocate sounds" << std::endl;
         return;
     }
 
-    // Apply the audio data, starting from the cursor positions,
-    // and finishing either at the end of the file, or the end of "numFrames".
-    auto frameCount = audioFile->getNumSamplesPerChannel();
-    auto last = cursors.size();
-    for (auto i = 0; i < last; i++) {
-        int32_t p = cursors[i];
-        for (auto f = 0; p < frameCount && f < numFrames; p++, f++) {
-            for (auto c = 0; c < channelCount; c++) {
-                outputBuffer[(f * numChannels) + c] += audioFile->samples[c][p];
+    // The files are independent, so each decodes on its own thread and the big ones don't hold
+    // up the rest. The asset manager is safe to use from several threads at once.
+    for (int32_t sound = 0; sound < bank_.getSoundCount(); sound++) {
+        loadResults_.push_back(std::async(std::launch::async, [this, assetManager, sound, numChannels, sampleRate]() {
+            auto &path = bank_.getEntry(sound).path;
+            if (!bank_.publish(sound, loadSoundFile(assetManager, bundle_, path, numChannels, sampleRate, sampleFormat_))) {
+                aout << "Failed to load sound " << path << std::endl;
             }
-        }
-        cursors[i] = p;
+        }).share());
     }
 
-    // Filter vector if the cursors have reached the end of the file.
-    for (auto i = 0; i < last; i++) {
-        while (last > i && cursors[i] >= frameCount) {
-            last -= 1;
-            cursors[i] = cursors[last];
-        }
+    // Once everything has decoded, save it for next time. A sound that failed isn't cached, so
+    // the next launch tries it again.
+    if (!cachePath_.empty()) {
+        cacheResult_ = std::async(std::launch::async, [this, key, loads = loadResults_]() {
+            for (auto &load : loads) {
+                load.wait();
+            }
+            for (int32_t sound = 0; sound < bank_.getSoundCount(); sound++) {
+                if (!bank_.isLoaded(sound)) {
+                    return;
+                }
+            }
+            if (SoundCache::write(cachePath_, key, bank_)) {
+                aout << "Cached " << bank_.getByteSize() << " bytes of sounds" << std::endl;
+            } else {
+                aout << "Failed to write sound cache " << cachePath_ << std::endl;
+            }
+        });
     }
-    cursors.resize(last);
 
 }
 
@@ -149,82 +559,149 @@ oboe::DataCallbackResult Sound::onAudioReady(oboe::AudioStream *oboeStream, void
             return oboe::DataCallbackResult::Stop;
     }
 
-    int numChannels = oboeStream->getChannelCount();
-    int numSamples = numFrames * numChannels;
+    auto startNs = nowNanos();
+    auto blockStartNs = getBlockStartNs(oboeStream, numFrames);
+    auto *recorder = activeRecorder_.load(std::memory_order_acquire);
+    if (oboeStream->getFormat() == oboe::AudioFormat::I16) {
+        mixer_.render(static_cast<int16_t*>(audioData), numFrames, oboeStream->getChannelCount(), blockStartNs);
+        if (recorder) {
+            recorder->record(static_cast<int16_t*>(audioData), numFrames);
+        }
+    } else {
+        mixer_.render(static_cast<float*>(audioData), numFrames, oboeStream->getChannelCount(), blockStartNs);
+        if (recorder) {
+            recorder->record(static_cast<float*>(audioData), numFrames);
+        }
+    }
+    auto deadlineNs = (numFrames * oboe::kNanosPerSecond) / oboeStream->getSampleRate();
+    stats_.recordCallback(nowNanos() - startNs, deadlineNs, mixer_.getVoiceCount());
+
+    // Read here rather than when the stats are asked for, since only this thread is sure the
+    // stream is still open.
+    auto xRuns = oboeStream->getXRunCount();
+    stats_.recordXRunCount(xRuns ? xRuns.value() : -1);
+
+    return oboe::DataCallbackResult::Continue;
+}
+
+int64_t Sound::getBlockStartNs(oboe::AudioStream *oboeStream, int32_t numFrames) {
+
+    // When the first frame of this block will be heard, going by the stream's frame clock rather
+    // than when the callback happened to wake up.
+    auto timestamp = oboeStream->getTimestamp(CLOCK_MONOTONIC);
+    if (!timestamp) {
+        return AudioRenderer::kUntimed;
+    }
+    auto sampleRate = oboeStream->getSampleRate();
+    auto framesAhead = oboeStream->getFramesWritten() - timestamp.value().position;
+    auto presentNs = timestamp.value().timestamp + (framesAhead * oboe::kNanosPerSecond) / sampleRate;
+
+    // Every trigger is heard a fixed delay after it was made. The delay is the output latency
+    // plus a block, so anything triggered since the last callback lands inside this block.
+    if (scheduleDelayNs_ == 0) {
+        scheduleDelayNs_ = (presentNs - nowNanos()) + (numFrames * oboe::kNanosPerSecond) / sampleRate;
+    }
+
+    return presentNs - scheduleDelayNs_;
+
+}
+
+AudioStatsSnapshot Sound::getStats() {
+    return stats_.snapshot();
+}
 
-    // Clear the sound.
-    auto *outputBuffer = static_cast<float*>(audioData);
-    memset(outputBuffer, 0, sizeof(float) * numSamples);
+bool Sound::playStream(const std::string &assetPath, bool loop, float gain) {
 
-    // For each sound, add the sound data to the stream.
-    // Pretty dumb method but there aren't many sounds.
-    if (regularPatSound_ && !regularPatSoundPlays_.empty()) {
-        playSoundArray(outputBuffer, regularPatSound_.get(), regularPatSoundPlays_, numChannels, numFrames);
+    // The player is made by the start task, so let it finish first.
+    if (asyncResult_.valid()) {
+        asyncResult_.wait();
     }
-    if (redPatSound_ && !redPatSoundPlays_.empty()) {
-        playSoundArray(outputBuffer, redPatSound_.get(), redPatSoundPlays_, numChannels, numFrames);
+    if (!streamPlayer_) {
+        return false;
     }
-    if (explosionSound_ && !explosionSoundPlays_.empty()) {
-        playSoundArray(outputBuffer, explosionSound_.get(), explosionSoundPlays_, numChannels, numFrames);
+
+    // Streaming mode reads the asset in pieces rather than mapping the whole file.
+    AAsset *asset = AAssetManager_open(assetManager_, assetPath.c_str(), AASSET_MODE_STREAMING);
+    if (!asset) {
+        aout << "Failed to open asset " << assetPath << std::endl;
+        return false;
     }
-    if (springSoundOne_ && !springSoundOnePlays_.empty()) {
-        playSoundArray(outputBuffer, springSoundOne_.get(), springSoundOnePlays_, numChannels, numFrames);
+    auto stream = WaveStream::open(std::make_unique<AssetWaveSource>(asset));
+    if (!stream) {
+        aout << "Failed to read WAV header of " << assetPath << std::endl;
+        return false;
     }
-    if (springSoundTwo_ && !springSoundTwoPlays_.empty()) {
-        playSoundArray(outputBuffer, springSoundTwo_.get(), springSoundTwoPlays_, numChannels, numFrames);
+
+    streamPlayer_->play(std::move(stream), loop, gain);
+    return true;
+
+}
+
+void Sound::stopStream() {
+    if (streamPlayer_) {
+        streamPlayer_->stop();
     }
-    if (springSoundThree_ && !springSoundThreePlays_.empty()) {
-        playSoundArray(outputBuffer, springSoundThree_.get(), springSoundThreePlays_, numChannels, numFrames);
+}
+
+bool Sound::startRecording(const std::string &path) {
+
+    // The stream is opened by the start task, so let it finish first. Any stream reopened since
+    // matches it, so the recording carries on through a reopen.
+    if (asyncResult_.valid()) {
+        asyncResult_.wait();
     }
-    if (springReboundSoundOne_ && !springReboundSoundOnePlays_.empty()) {
-        playSoundArray(outputBuffer, springReboundSoundOne_.get(), springReboundSoundOnePlays_, numChannels, numFrames);
+    return beginRecording(path);
+
+}
+
+bool Sound::beginRecording(const std::string &path) {
+
+    if (sampleRate_ == 0) {
+        return false;
     }
-    if (springReboundSoundTwo_ && !springReboundSoundTwoPlays_.empty()) {
-        playSoundArray(outputBuffer, springReboundSoundTwo_.get(), springReboundSoundTwoPlays_, numChannels, numFrames);
+
+    if (!recorder_) {
+        recorder_ = std::make_unique<SessionRecorder>(numChannels_, sampleRate_);
+        activeRecorder_.store(recorder_.get(), std::memory_order_release);
     }
-    if (springReboundSoundThree_ && !springReboundSoundThreePlays_.empty()) {
-        playSoundArray(outputBuffer, springReboundSoundThree_.get(), springReboundSoundThreePlays_, numChannels, numFrames);
+    if (!recorder_->start(path)) {
+        aout << "Failed to start recording to " << path << std::endl;
+        return false;
     }
+    aout << "Recording audio to " << path << std::endl;
+    return true;
 
-    return oboe::DataCallbackResult::Continue;
 }
 
-void Sound::playRegularPat() {
-    if (regularPatSound_) {
-        regularPatSoundPlays_.push_back(0);
+void Sound::stopRecording() {
+    if (recorder_ && recorder_->stop()) {
+        aout << "Stopped recording audio, " << recorder_->getDroppedFrames() << " frames dropped" << std::endl;
     }
 }
 
-void Sound::playRedPat() {
-    if (redPatSound_) {
-        redPatSoundPlays_.push_back(0);
+void Sound::play(int32_t group) {
+    auto sound = bank_.pickVariant(group, (uint32_t) random_());
+    if (sound != SoundBank::kNoSound) {
+        mixer_.trigger(sound, nowNanos());
     }
 }
 
+void Sound::playRegularPat() {
+    play(patGroup_);
+}
+
+void Sound::playRedPat() {
+    play(redPatGroup_);
+}
+
 void Sound::playExplosion() {
-    if (redPatSound_) {
-        explosionSoundPlays_.push_back(0);
-    }
+    play(explosionGroup_);
 }
 
 void Sound::playSpringPat() {
-    int n = rand() % 3;
-    if (n == 2) {
-        springSoundOnePlays_.push_back(0);
-    } else if (n == 1) {
-        springSoundTwoPlays_.push_back(0);
-    } else {
-        springSoundThreePlays_.push_back(0);
-    }
+    play(springPatGroup_);
 }
 
 void Sound::playSpringRebound() {
-    int n = rand() % 3;
-    if (n == 2) {
-        springReboundSoundOnePlays_.push_back(0);
-    } else if (n == 1) {
-        springReboundSoundTwoPlays_.push_back(0);
-    } else {
-        springReboundSoundThreePlays_.push_back(0);
-    }
+    play(springReboundGroup_);
 }
@@ -5,25 +5,98 @@
 #ifndef PAT_PLAY_SOUND_H
 #define PAT_PLAY_SOUND_H
 
+#include <atomic>
+#include <condition_variable>
 #include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
 
 #include <android/asset_manager.h>
 #include <oboe/Oboe.h>
 
-#include "AudioFile.h"
+#include "AssetBundle.h"
+#include "Mixer.h"
+#include "SessionRecorder.h"
+#include "SoundBank.h"
+#include "SoundCache.h"
+#include "StreamPlayer.h"
 
 class Sound: oboe::AudioStreamDataCallback {
 public:
 
-    inline Sound() {}
+    Sound();
 
-    ~Sound() {
-        stop();
-    }
+    ~Sound();
 
-    void startAsync(AAssetManager *assetManager);
+    /*!
+     * Sets how loaded sounds are stored. Int16, the default, uses half the memory of Float, and
+     * the mixer converts it as it plays. Only takes effect for sounds loaded afterwards.
+     */
+    void setSampleFormat(SampleFormat format);
+
+    /*!
+     * Keeps the decoded sounds in a file, so later launches can map them rather than decode them
+     * again. The file is rebuilt whenever the app, the manifest or the output format changes.
+     * Only takes effect for sounds loaded afterwards.
+     * @param path Where to keep the cache, somewhere in internal storage
+     */
+    void setCachePath(const std::string &path);
+
+    /*!
+     * Reads the sound manifest, then opens the stream and loads the sounds in the background.
+     * The groups are known when this returns, though their sounds are silent until loaded.
+     */
+    void startAsync(AAssetManager *assetManager, const AssetBundle *bundle);
     void stop();
 
+    /*!
+     * Pauses and resumes the stream, keeping it and all loaded sounds around.
+     */
+    void pause();
+    void resume();
+
+    /*!
+     * Copies out the audio callback's counters and how the stream was opened. Takes no locks, so
+     * it never waits on a stream being opened.
+     */
+    AudioStatsSnapshot getStats();
+
+    /*!
+     * Plays one of a group's sounds, picked at random.
+     * @param group The group's number in the sound manifest
+     */
+    void play(int32_t group);
+
+    /*!
+     * Streams a long WAV asset, like music, decoding it in the background as it plays. Replaces
+     * any stream already playing.
+     * @param assetPath The WAV to play
+     * @param loop Whether to go back to the start at the end
+     * @param gain How loud to mix it
+     * @return false if the asset can't be opened as a WAV
+     */
+    bool playStream(const std::string &assetPath, bool loop, float gain = 1.0f);
+    void stopStream();
+
+    /*!
+     * Records everything the stream plays to a WAV file, until stopped or the sound goes away.
+     * Waits for the stream to open.
+     * @param path Where to write the file, replacing anything there
+     * @return false if there's no stream, or the file can't be created
+     */
+    bool startRecording(const std::string &path);
+    void stopRecording();
+
+    /*!
+     * Records to a WAV file from the moment the stream starts, like @a startRecording but without
+     * waiting for the stream to open. Only call this before @a startAsync.
+     * @param path Where to write the file, replacing anything there
+     */
+    void setRecordingPath(const std::string &path);
+
     void playRegularPat();
     void playRedPat();
     void playExplosion();
@@ -32,34 +105,152 @@ public:
 
 private:
 
+    /*!
+     * Takes Oboe's error callbacks for every stream the sound opens. Oboe calls them on a thread of
+     * its own that can still be on its way in after the sound has stopped, so each stream shares
+     * ownership of this rather than pointing at the sound. The sound detaches it before going
+     * away, and callbacks after that do nothing.
+     */
+    class ErrorCallback: public oboe::AudioStreamErrorCallback {
+    public:
+
+        inline explicit ErrorCallback(Sound *sound): sound_(sound) {}
+
+        /*!
+         * Stops passing callbacks on, waiting for one already in the sound to return.
+         */
+        void detach();
+
+        void onErrorAfterClose(oboe::AudioStream *oboeStream, oboe::Result error) override;
+
+    private:
+        std::mutex mutex_;
+        Sound *sound_;
+    };
+
     void start();
-    bool openStream();
-    bool loadSounds(AAssetManager *assetManager);
+
+    /*!
+     * Opens the stream in the device's native format if the mixer can write it, so Oboe doesn't
+     * put a conversion in the way of the low latency path. Falls back to float with Oboe converting.
+     * Doesn't touch @a mAudioStream, so it needs no lock, but only call it while no stream is
+     * running.
+     * @param sampleRate The rate to ask for, resampled by Oboe if the device runs at another, or 0
+     * for the device's own
+     * @return the stream, not started, or null if it couldn't be opened
+     */
+    std::shared_ptr<oboe::AudioStream> openStream(int32_t sampleRate);
+
+    /*!
+     * Opens a new stream like the one that was lost, at the rate and channel count the sounds were
+     * loaded for, and starts it unless the game is paused. The bank, the voices and the streaming
+     * and recording are all carried over. Tries again a few times, further apart each time, if the
+     * new device isn't ready. Runs on a worker thread.
+     */
+    void restart();
+
+    /*!
+     * Makes the recorder if needed and starts it, once the stream's format is known.
+     */
+    bool beginRecording(const std::string &path);
+
+    /*!
+     * Reads the manifest into the bank and looks up the groups the game plays.
+     */
+    void loadManifest(AAssetManager *assetManager);
+
+    /*!
+     * Lays out the bank, then maps the cached sounds if they match. Otherwise starts decoding every
+     * sound on its own worker thread, and saves them to the cache once they're all done. Each sound
+     * is published as soon as it's ready, so the stream can already be running. Runs on its own
+     * task, so the game thread never waits for it.
+     */
+    void loadSounds(AAssetManager *assetManager, int32_t numChannels, int32_t sampleRate);
     oboe::DataCallbackResult onAudioReady(oboe::AudioStream *oboeStream, void *audioData, int32_t numFrames) override;
 
+    /*!
+     * Called through the error callback once a stream that failed, usually because the device was
+     * disconnected, has been closed. Starts reopening it in the background.
+     */
+    void onStreamError(oboe::AudioStream *oboeStream, oboe::Result error);
+
+    /*!
+     * Works out the trigger time the next block of @a numFrames plays for, from the stream's
+     * timestamp. Only call this from the audio callback.
+     * @return the time in nanoseconds, or @a AudioRenderer::kUntimed if the stream can't say
+     */
+    int64_t getBlockStartNs(oboe::AudioStream *oboeStream, int32_t numFrames);
+
     AAssetManager* assetManager_;
+    const AssetBundle* bundle_;
+    SampleFormat sampleFormat_;
+    std::string cachePath_;
+    std::string recordingPath_;
+
+    // How long after a trigger its sound is heard. Set from the first timestamped block.
+    int64_t scheduleDelayNs_;
     std::shared_ptr<oboe::AudioStream> mAudioStream;
+
+    // Guards the stream and everything about it below, since a disconnected stream is replaced
+    // in the background. Never held while a stream is opened.
+    std::mutex streamMutex_;
+
+    // Signalled when the sound is stopped, to wake a restart waiting to try again.
+    std::condition_variable streamCondition_;
+
+    // Shared with every stream opened, and detached by the destructor.
+    std::shared_ptr<ErrorCallback> errorCallback_;
+
+    // What the sounds were loaded for, which a reopened stream has to match. Set once by the
+    // start task, so readable without the lock once it has finished.
+    int32_t numChannels_;
+    int32_t sampleRate_;
+
+    // Whether the game has paused the stream, or stopped it for good.
+    bool paused_;
+    bool stopped_;
+
+    // Reopens a disconnected stream. Only touched holding the lock.
+    std::future<void> restartResult_;
+
     std::future<void> asyncResult_;
 
-    std::vector<int32_t> regularPatSoundPlays_;
-    std::vector<int32_t> redPatSoundPlays_;
-    std::vector<int32_t> explosionSoundPlays_;
-    std::vector<int32_t> springSoundOnePlays_;
-    std::vector<int32_t> springSoundTwoPlays_;
-    std::vector<int32_t> springSoundThreePlays_;
-    std::vector<int32_t> springReboundSoundOnePlays_;
-    std::vector<int32_t> springReboundSoundTwoPlays_;
-    std::vector<int32_t> springReboundSoundThreePlays_;
-
-    std::unique_ptr<AudioFile<float>> regularPatSound_;
-    std::unique_ptr<AudioFile<float>> redPatSound_;
-    std::unique_ptr<AudioFile<float>> explosionSound_;
-    std::unique_ptr<AudioFile<float>> springSoundOne_;
-    std::unique_ptr<AudioFile<float>> springSoundTwo_;
-    std::unique_ptr<AudioFile<float>> springSoundThree_;
-    std::unique_ptr<AudioFile<float>> springReboundSoundOne_;
-    std::unique_ptr<AudioFile<float>> springReboundSoundTwo_;
-    std::unique_ptr<AudioFile<float>> springReboundSoundThree_;
+    // Measures the sounds and maps the cache or starts the decodes, started by the start task.
+    // Nothing on the game thread waits for it.
+    std::future<void> soundsResult_;
+
+    // One decode per sound, started by the sounds task. Shared with the cache write, which waits
+    // for all of them.
+    std::vector<std::shared_future<void>> loadResults_;
+    std::future<void> cacheResult_;
+
+    // Counters updated by the audio callback.
+    AudioStats stats_;
+
+    // The sounds from an earlier launch. Outlives the bank, which may be playing from it.
+    SoundCache cache_;
+
+    // Every sound, and the groups the game plays from it.
+    SoundBank bank_;
+    int32_t patGroup_;
+    int32_t redPatGroup_;
+    int32_t explosionGroup_;
+    int32_t springPatGroup_;
+    int32_t springReboundGroup_;
+
+    // Picks variants. Only used by the game thread.
+    std::minstd_rand random_;
+
+    // Plays streamed sounds. Made once the stream's format is known.
+    std::unique_ptr<StreamPlayer> streamPlayer_;
+
+    // Records the stream's output. Made the first time it's needed and kept until the stream is
+    // gone, since the audio callback may be using it. The callback reads it through the atomic.
+    std::unique_ptr<SessionRecorder> recorder_;
+    std::atomic<SessionRecorder *> activeRecorder_;
+
+    // Mixes every playing sound. Sounds are handed to it once loaded.
+    Mixer mixer_;
 
 };
 
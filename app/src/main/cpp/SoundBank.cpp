@@ -0,0 +1,142 @@
+#include "SoundBank.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+// Sounds start on a multiple of this many frames, which puts every one on a cache line.
+static constexpr size_t kSlotAlignmentFrames = SoundBuffer::kAlignment;
+
+bool SoundBank::parseManifest(const char *text, size_t length) {
+
+    entries_.clear();
+    groupNames_.clear();
+    groups_.clear();
+
+    std::istringstream manifest(std::string(text, length));
+    std::string line;
+    while (std::getline(manifest, line)) {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string group;
+        int32_t priority;
+        std::string path;
+        if (!(fields >> group)) {
+            continue;
+        }
+        if (!(fields >> priority >> path) || addSound(group, priority, path) == kNoSound) {
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+int32_t SoundBank::addSound(const std::string &group, int32_t priority, const std::string &path) {
+
+    if (getSoundCount() >= kMaxSounds) {
+        return kNoSound;
+    }
+
+    auto groupId = findGroup(group);
+    if (groupId == kNoSound) {
+        groupId = (int32_t) groups_.size();
+        groupNames_.push_back(group);
+        groups_.emplace_back();
+    }
+
+    auto sound = getSoundCount();
+    entries_.push_back(SoundBankEntry { groupId, priority, path });
+    groups_[groupId].push_back(sound);
+    return sound;
+
+}
+
+int32_t SoundBank::findGroup(const std::string &name) const {
+    auto it = std::find(groupNames_.begin(), groupNames_.end(), name);
+    return it == groupNames_.end() ? kNoSound : (int32_t) (it - groupNames_.begin());
+}
+
+int32_t SoundBank::pickVariant(int32_t group, uint32_t random) const {
+    if (group < 0 || group >= (int32_t) groups_.size()) {
+        return kNoSound;
+    }
+    auto &sounds = groups_[group];
+    return sounds[random % sounds.size()];
+}
+
+size_t SoundBank::layout(const std::vector<int32_t> &numFrames) {
+
+    // Lay the sounds out back to back, each one starting on an aligned frame.
+    slots_.assign(entries_.size(), Slot { 0, 0 });
+    size_t totalFrames = 0;
+    for (size_t i = 0; i < slots_.size() && i < numFrames.size(); i++) {
+        slots_[i].offset = totalFrames * numChannels_;
+        slots_[i].numFrames = std::max(numFrames[i], 0);
+        totalFrames += slots_[i].numFrames;
+        totalFrames = (totalFrames + kSlotAlignmentFrames - 1) & ~(kSlotAlignmentFrames - 1);
+    }
+    return totalFrames;
+
+}
+
+bool SoundBank::allocate(SampleFormat format, int32_t numChannels, int32_t sampleRate, const std::vector<int32_t> &numFrames) {
+
+    numChannels_ = numChannels;
+    sampleRate_ = sampleRate;
+    auto totalFrames = layout(numFrames);
+
+    arena_ = SoundBuffer::silent(format, (int32_t) totalFrames, numChannels, sampleRate);
+    samples_ = arena_.getWritableData();
+    byteSize_ = arena_.getByteSize();
+    format_ = format;
+    return !arena_.isEmpty() || totalFrames == 0;
+
+}
+
+bool SoundBank::attach(SampleFormat format, int32_t numChannels, int32_t sampleRate, const std::vector<int32_t> &numFrames, const void *samples, size_t byteSize) {
+
+    numChannels_ = numChannels;
+    sampleRate_ = sampleRate;
+    auto totalFrames = layout(numFrames);
+    auto sampleSize = format == SampleFormat::Int16 ? sizeof(int16_t) : sizeof(float);
+    if (!samples || byteSize != totalFrames * numChannels * sampleSize) {
+        return false;
+    }
+
+    arena_ = SoundBuffer();
+    samples_ = samples;
+    byteSize_ = byteSize;
+    format_ = format;
+    for (size_t sound = 0; sound < slots_.size(); sound++) {
+        loaded_[sound].store(true, std::memory_order_release);
+    }
+    return true;
+
+}
+
+bool SoundBank::publish(int32_t sound, const SoundBuffer &buffer) {
+
+    if (sound < 0 || sound >= (int32_t) slots_.size() || arena_.isEmpty()) {
+        return false;
+    }
+    if (buffer.getFormat() != arena_.getFormat() || buffer.getNumChannels() != numChannels_) {
+        return false;
+    }
+
+    auto &slot = slots_[sound];
+    auto samples = (size_t) std::min(slot.numFrames, buffer.getNumFrames()) * numChannels_;
+    if (arena_.getFormat() == SampleFormat::Int16) {
+        auto *data = static_cast<int16_t *>(arena_.getWritableData());
+        memcpy(data + slot.offset, buffer.getPcm16(), samples * sizeof(int16_t));
+    } else {
+        auto *data = static_cast<float *>(arena_.getWritableData());
+        memcpy(data + slot.offset, buffer.getData(), samples * sizeof(float));
+    }
+
+    loaded_[sound].store(true, std::memory_order_release);
+    return true;
+
+}
@@ -0,0 +1,176 @@
+#ifndef PAT_PLAY_SOUNDBANK_H
+#define PAT_PLAY_SOUNDBANK_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SoundBuffer.h"
+
+/*!
+ * One sound listed in a manifest.
+ */
+struct SoundBankEntry {
+    // Sounds sharing a group are variants of each other.
+    int32_t group;
+
+    // Voices of a higher priority sound are stolen last.
+    int32_t priority;
+
+    std::string path;
+};
+
+/*!
+ * Every sound the game can play, listed by a manifest and stored together in one contiguous arena
+ * in the output's format, channel count and rate.
+ *
+ * Sounds are numbered in manifest order, and the mixer is triggered with those numbers. Groups are
+ * numbered in order of first appearance, and @a pickVariant chooses one of a group's sounds.
+ *
+ * The manifest is a text file with one sound per line: its group name, its priority and its asset
+ * path, separated by whitespace. Anything after a '#' is a comment.
+ *
+ * Setting up happens in three steps. The manifest is read, the arena is allocated once every
+ * sound's length is known, then each sound is published as it's decoded. The audio thread can be
+ * rendering from the bank by the time anything is published, and never sees a sound that isn't.
+ */
+class SoundBank {
+public:
+
+    // Most sounds a bank can hold, so the mixer can keep per-sound state in fixed arrays.
+    static constexpr int32_t kMaxSounds = 64;
+
+    static constexpr int32_t kNoSound = -1;
+
+    inline SoundBank(): loaded_(), samples_(nullptr), byteSize_(0), format_(SampleFormat::Float), numChannels_(0), sampleRate_(0) {}
+
+    /*!
+     * Replaces the bank's sounds with a manifest's. Only call this while no sound is published.
+     * @return false if the manifest has a malformed line or too many sounds
+     */
+    bool parseManifest(const char *text, size_t length);
+
+    /*!
+     * Adds one sound, for building a bank without a manifest. Only call this while no sound is
+     * published.
+     * @return the new sound, or @a kNoSound if the bank is full
+     */
+    int32_t addSound(const std::string &group, int32_t priority, const std::string &path);
+
+    inline int32_t getSoundCount() const { return (int32_t) entries_.size(); }
+    inline const SoundBankEntry &getEntry(int32_t sound) const { return entries_[sound]; }
+
+    /*!
+     * @return the group with the given name, or @a kNoSound if there isn't one
+     */
+    int32_t findGroup(const std::string &name) const;
+
+    /*!
+     * Chooses one of a group's sounds.
+     * @param group The group to play
+     * @param random Any random number, which selects the variant
+     * @return the sound, or @a kNoSound if there's no such group
+     */
+    int32_t pickVariant(int32_t group, uint32_t random) const;
+
+    /*!
+     * Allocates silent space for every sound. Only call this while no sound is published, which
+     * is safe while the mixer is rendering from the bank.
+     * @param format How to store the samples
+     * @param numChannels Channels of every sound
+     * @param sampleRate Rate of every sound
+     * @param numFrames The length of each sound, in manifest order
+     * @return false if the allocation failed
+     */
+    bool allocate(SampleFormat format, int32_t numChannels, int32_t sampleRate, const std::vector<int32_t> &numFrames);
+
+    /*!
+     * Uses samples decoded on an earlier run instead of allocating, and publishes every sound at
+     * once. The samples must stay put for as long as the bank is used. Only call this while no
+     * sound is published.
+     * @param samples Every sound, laid out as @a allocate would for the same lengths
+     * @param byteSize The bytes of @a samples
+     * @return false if @a samples is the wrong size for the lengths
+     */
+    bool attach(SampleFormat format, int32_t numChannels, int32_t sampleRate, const std::vector<int32_t> &numFrames, const void *samples, size_t byteSize);
+
+    /*!
+     * Copies a decoded sound into its space in the arena and makes it playable. Safe from any
+     * thread while rendering, with one thread per sound.
+     * @param sound The sound to fill
+     * @param buffer The decoded sound in the arena's format, channel count and rate. Anything past
+     * the allocated length is cut off, and anything short of it left silent.
+     * @return false if the buffer doesn't match the arena
+     */
+    bool publish(int32_t sound, const SoundBuffer &buffer);
+
+    /*!
+     * @return whether a sound has been published, after which its data can be read from any thread
+     */
+    inline bool isLoaded(int32_t sound) const {
+        return sound >= 0 && sound < kMaxSounds && loaded_[sound].load(std::memory_order_acquire);
+    }
+
+    inline SampleFormat getFormat() const { return format_; }
+    inline int32_t getNumChannels() const { return numChannels_; }
+    inline int32_t getSampleRate() const { return sampleRate_; }
+
+    inline int32_t getNumFrames(int32_t sound) const { return slots_[sound].numFrames; }
+
+    /*!
+     * @return the first sample of a sound in a Float arena
+     */
+    inline const float *getData(int32_t sound) const { return static_cast<const float *>(samples_) + slots_[sound].offset; }
+
+    /*!
+     * @return the first sample of a sound in an Int16 arena
+     */
+    inline const int16_t *getPcm16(int32_t sound) const { return static_cast<const int16_t *>(samples_) + slots_[sound].offset; }
+
+    /*!
+     * @return the whole arena, every sound back to back
+     */
+    inline const void *getSamples() const { return samples_; }
+
+    /*!
+     * @return the bytes of sample data held in the arena
+     */
+    inline size_t getByteSize() const { return byteSize_; }
+
+private:
+
+    /*!
+     * Works out where each sound goes in the arena.
+     * @return the frames the arena needs
+     */
+    size_t layout(const std::vector<int32_t> &numFrames);
+
+    struct Slot {
+        // Samples from the start of the arena.
+        size_t offset;
+        int32_t numFrames;
+    };
+
+    std::vector<SoundBankEntry> entries_;
+    std::vector<std::string> groupNames_;
+    std::vector<std::vector<int32_t>> groups_;
+
+    // Whether each sound's slot is filled. Set with release once the samples are copied in, and
+    // read with acquire before anything touches them.
+    std::array<std::atomic<bool>, kMaxSounds> loaded_;
+
+    // Owns the samples, unless they were attached from elsewhere.
+    SoundBuffer arena_;
+    const void *samples_;
+    size_t byteSize_;
+    SampleFormat format_;
+
+    std::vector<Slot> slots_;
+    int32_t numChannels_;
+    int32_t sampleRate_;
+
+};
+
+#endif //PAT_PLAY_SOUNDBANK_H
@@ -0,0 +1,142 @@
+#include "SoundBuffer.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "Resampler.h"
+
+SoundBuffer SoundBuffer::fromPlanar(const std::vector<std::vector<float>> &samples, int32_t numChannels, int32_t sampleRate, SampleFormat format) {
+    auto numFrames = samples.empty() ? 0 : (int32_t) samples[0].size();
+    return convert(format, numFrames, (int32_t) samples.size(), numChannels, sampleRate, [&](int32_t c, int32_t f) {
+        return samples[c][f];
+    });
+}
+
+SoundBuffer SoundBuffer::fromInterleaved(const int16_t *pcm, int32_t numFrames, int32_t sourceChannels, int32_t numChannels, int32_t sampleRate, SampleFormat format) {
+
+    // Already in the right layout, so there's nothing to convert.
+    if (format == SampleFormat::Int16 && sourceChannels == numChannels && numFrames > 0) {
+        SoundBuffer buffer;
+        buffer.allocate(format, numFrames, numChannels, sampleRate);
+        if (!buffer.isEmpty()) {
+            memcpy(buffer.data_.get(), pcm, buffer.getByteSize());
+        }
+        return buffer;
+    }
+
+    return convert(format, numFrames, sourceChannels, numChannels, sampleRate, [&](int32_t c, int32_t f) {
+        return (float) pcm[(f * sourceChannels) + c] / 32768.0f;
+    });
+
+}
+
+SoundBuffer SoundBuffer::silent(SampleFormat format, int32_t numFrames, int32_t numChannels, int32_t sampleRate) {
+    SoundBuffer buffer;
+    if (numFrames > 0 && numChannels > 0) {
+        buffer.allocate(format, numFrames, numChannels, sampleRate);
+    }
+    return buffer;
+}
+
+SoundBuffer SoundBuffer::resampledTo(int32_t sampleRate) const {
+
+    SoundBuffer buffer;
+    if (isEmpty() || sampleRate <= 0) {
+        return buffer;
+    }
+
+    if (sampleRate == sampleRate_) {
+        buffer.allocate(format_, numFrames_, numChannels_, sampleRate_);
+        if (!buffer.isEmpty()) {
+            memcpy(buffer.data_.get(), data_.get(), getByteSize());
+        }
+        return buffer;
+    }
+
+    // The resampler works in float, so Int16 goes through a float copy both ways.
+    auto numSamples = (size_t) numFrames_ * numChannels_;
+    std::vector<float> widened;
+    auto *input = getData();
+    if (format_ == SampleFormat::Int16) {
+        widened.resize(numSamples);
+        for (size_t i = 0; i < numSamples; i++) {
+            widened[i] = (float) getPcm16()[i] / 32768.0f;
+        }
+        input = widened.data();
+    }
+
+    Resampler resampler(sampleRate_, sampleRate);
+    auto outputFrames = resampler.getOutputFrames(numFrames_);
+    std::vector<float> output((size_t) outputFrames * numChannels_);
+    resampler.process(input, numFrames_, numChannels_, output.data());
+
+    buffer.allocate(format_, outputFrames, numChannels_, sampleRate);
+    for (size_t i = 0; i < output.size() && !buffer.isEmpty(); i++) {
+        buffer.store(i, output[i]);
+    }
+    return buffer;
+
+}
+
+void SoundBuffer::allocate(SampleFormat format, int32_t numFrames, int32_t numChannels, int32_t sampleRate) {
+
+    // aligned_alloc wants a whole number of alignment units.
+    auto bytes = sampleSize(format) * numFrames * numChannels;
+    bytes = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+
+    data_.reset(std::aligned_alloc(kAlignment, bytes));
+    if (!data_) {
+        numFrames_ = 0;
+        return;
+    }
+    memset(data_.get(), 0, bytes);
+
+    format_ = format;
+    numFrames_ = numFrames;
+    numChannels_ = numChannels;
+    sampleRate_ = sampleRate;
+
+}
+
+void SoundBuffer::store(size_t i, float sample) {
+    if (format_ == SampleFormat::Int16) {
+        auto scaled = std::lround(sample * 32768.0f);
+        static_cast<int16_t *>(data_.get())[i] = (int16_t) (scaled > 32767 ? 32767 : (scaled < -32768 ? -32768 : scaled));
+    } else {
+        static_cast<float *>(data_.get())[i] = sample;
+    }
+}
+
+template <typename Sample>
+SoundBuffer SoundBuffer::convert(SampleFormat format, int32_t numFrames, int32_t sourceChannels, int32_t numChannels, int32_t sampleRate, Sample &&sample) {
+
+    SoundBuffer buffer;
+    if (numFrames <= 0 || sourceChannels <= 0 || numChannels <= 0) {
+        return buffer;
+    }
+    buffer.allocate(format, numFrames, numChannels, sampleRate);
+    if (buffer.isEmpty()) {
+        return buffer;
+    }
+
+    size_t i = 0;
+    for (int32_t f = 0; f < numFrames; f++) {
+        for (int32_t c = 0; c < numChannels; c++, i++) {
+            if (sourceChannels <= numChannels) {
+                // Fewer source channels repeat across the output, so mono plays on every channel.
+                buffer.store(i, sample(c % sourceChannels, f));
+            } else {
+                // More source channels fold down, averaging every one that lands on this output.
+                float sum = 0.0f;
+                int32_t count = 0;
+                for (int32_t s = c; s < sourceChannels; s += numChannels, count++) {
+                    sum += sample(s, f);
+                }
+                buffer.store(i, sum / (float) count);
+            }
+        }
+    }
+
+    return buffer;
+
+}
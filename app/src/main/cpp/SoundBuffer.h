@@ -0,0 +1,124 @@
+#ifndef PAT_PLAY_SOUNDBUFFER_H
+#define PAT_PLAY_SOUNDBUFFER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/*!
+ * How the samples of a @a SoundBuffer are stored.
+ */
+enum class SampleFormat {
+    // 32-bit floats from -1 to 1.
+    Float,
+
+    // Signed 16-bit PCM, half the memory. The mixer widens it to float as it goes.
+    Int16,
+};
+
+/*!
+ * Decoded sound data, laid out exactly as the mixer consumes it: one contiguous block of
+ * interleaved frames with the output stream's channel count, aligned to a cache line.
+ *
+ * Channel layouts are converted once when the buffer is filled. A mono source is copied to every
+ * output channel, and a source with more channels than the output has the extras averaged in.
+ */
+class SoundBuffer {
+public:
+
+    static constexpr size_t kAlignment = 64;
+
+    inline SoundBuffer(): format_(SampleFormat::Float), numFrames_(0), numChannels_(0), sampleRate_(0) {}
+
+    /*!
+     * Builds a buffer from separate per-channel sample arrays, like AudioFile's.
+     * @param samples One vector of samples per source channel, all the same length
+     * @param numChannels Channels in the buffer
+     * @param sampleRate Rate of the samples
+     * @param format How to store the samples
+     */
+    static SoundBuffer fromPlanar(const std::vector<std::vector<float>> &samples, int32_t numChannels, int32_t sampleRate, SampleFormat format);
+
+    /*!
+     * Builds a buffer from interleaved signed 16-bit PCM. Stored as Int16 with a matching channel
+     * count, the PCM is copied as is.
+     * @param pcm The first sample
+     * @param numFrames Frames of PCM
+     * @param sourceChannels Channels in the PCM
+     * @param numChannels Channels in the buffer
+     * @param sampleRate Rate of the samples
+     * @param format How to store the samples
+     */
+    static SoundBuffer fromInterleaved(const int16_t *pcm, int32_t numFrames, int32_t sourceChannels, int32_t numChannels, int32_t sampleRate, SampleFormat format);
+
+    /*!
+     * Builds a buffer of silence, to be filled in through @a getWritableData.
+     */
+    static SoundBuffer silent(SampleFormat format, int32_t numFrames, int32_t numChannels, int32_t sampleRate);
+
+    /*!
+     * Makes a copy converted to another sample rate with a @a Resampler, in the same format.
+     * @return the converted buffer, or a copy if the rate already matches
+     */
+    SoundBuffer resampledTo(int32_t sampleRate) const;
+
+    inline bool isEmpty() const { return numFrames_ == 0; }
+    inline SampleFormat getFormat() const { return format_; }
+
+    /*!
+     * @return the samples of a Float buffer
+     */
+    inline const float *getData() const { return static_cast<const float *>(data_.get()); }
+
+    /*!
+     * @return the samples of an Int16 buffer
+     */
+    inline const int16_t *getPcm16() const { return static_cast<const int16_t *>(data_.get()); }
+
+    /*!
+     * @return the samples, for whoever is filling in a @a silent buffer
+     */
+    inline void *getWritableData() { return data_.get(); }
+
+    inline int32_t getNumFrames() const { return numFrames_; }
+    inline int32_t getNumChannels() const { return numChannels_; }
+    inline int32_t getSampleRate() const { return sampleRate_; }
+
+    /*!
+     * @return the bytes of sample data held
+     */
+    inline size_t getByteSize() const { return sampleSize(format_) * numFrames_ * numChannels_; }
+
+private:
+
+    struct Free {
+        inline void operator()(void *data) const { std::free(data); }
+    };
+
+    static inline size_t sampleSize(SampleFormat format) {
+        return format == SampleFormat::Int16 ? sizeof(int16_t) : sizeof(float);
+    }
+
+    /*!
+     * Allocates zeroed, aligned storage. Leaves the buffer empty if the allocation fails.
+     */
+    void allocate(SampleFormat format, int32_t numFrames, int32_t numChannels, int32_t sampleRate);
+
+    /*!
+     * Stores float sample @a i, quantizing it if the buffer is Int16.
+     */
+    void store(size_t i, float sample);
+
+    template <typename Sample>
+    static SoundBuffer convert(SampleFormat format, int32_t numFrames, int32_t sourceChannels, int32_t numChannels, int32_t sampleRate, Sample &&sample);
+
+    std::unique_ptr<void, Free> data_;
+    SampleFormat format_;
+    int32_t numFrames_;
+    int32_t numChannels_;
+    int32_t sampleRate_;
+
+};
+
+#endif //PAT_PLAY_SOUNDBUFFER_H
@@ -0,0 +1,193 @@
+#include "SoundCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AndroidOut.h"
+
+static constexpr uint32_t kCacheVersion = 2;
+
+// Where the samples start. Past the header and every sound's length, and on a cache line.
+static constexpr size_t kDataOffset = 4096;
+
+// How far apart to read the mapping to bring all of it in.
+static constexpr size_t kTouchStride = 4096;
+
+struct SoundCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t appVersion;
+    uint32_t manifestHash;
+    uint32_t format;
+    int32_t numChannels;
+    int32_t sampleRate;
+    uint32_t soundCount;
+    uint64_t dataSize;
+    uint64_t contentHash;
+};
+
+static_assert(sizeof(SoundCacheHeader) + SoundBank::kMaxSounds * sizeof(int32_t) <= kDataOffset, "The header must fit before the samples");
+
+bool SoundCache::map(const std::string &path, const SoundCacheKey &key, const std::vector<int32_t> &numFrames) {
+
+    unmap();
+
+    auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < kDataOffset) {
+        ::close(fd);
+        return false;
+    }
+    auto size = (size_t) info.st_size;
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<const uint8_t *>(mapping);
+    size_ = size;
+
+    SoundCacheHeader header {};
+    memcpy(&header, data_, sizeof(header));
+    auto matches = memcmp(header.magic, "PPSC", 4) == 0
+            && header.version == kCacheVersion
+            && header.appVersion == key.appVersion
+            && header.manifestHash == key.manifestHash
+            && header.contentHash == key.contentHash
+            && header.format == (uint32_t) key.format
+            && header.numChannels == key.numChannels
+            && header.sampleRate == key.sampleRate
+            && header.soundCount == numFrames.size()
+            && header.dataSize == size - kDataOffset;
+
+    // A sound that measures differently has changed since the cache was made.
+    for (size_t i = 0; matches && i < numFrames.size(); i++) {
+        int32_t cachedFrames;
+        memcpy(&cachedFrames, data_ + sizeof(header) + i * sizeof(int32_t), sizeof(cachedFrames));
+        matches = cachedFrames == numFrames[i];
+    }
+    if (!matches) {
+        unmap();
+        return false;
+    }
+
+    // Fault every page in now, on this thread, rather than on the audio thread mid-callback. The
+    // pages are clean, so the kernel could drop them again and the audio thread would read them
+    // back from storage. Locking them stops that, if the process is allowed to lock this much.
+    madvise(mapping, size, MADV_WILLNEED);
+    uint8_t sum = 0;
+    for (size_t offset = kDataOffset; offset < size; offset += kTouchStride) {
+        sum += *static_cast<const volatile uint8_t *>(data_ + offset);
+    }
+    (void) sum;
+    locked_ = mlock(mapping, size) == 0;
+    if (!locked_) {
+        aout << "Couldn't lock " << size << " bytes of cached sounds in memory" << std::endl;
+    }
+
+    return true;
+
+}
+
+void SoundCache::unmap() {
+    if (data_) {
+        if (locked_) {
+            munlock(data_, size_);
+        }
+        munmap(const_cast<uint8_t *>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    locked_ = false;
+}
+
+const void *SoundCache::getSamples() const {
+    return data_ ? data_ + kDataOffset : nullptr;
+}
+
+size_t SoundCache::getByteSize() const {
+    return data_ ? size_ - kDataOffset : 0;
+}
+
+bool SoundCache::write(const std::string &path, const SoundCacheKey &key, const SoundBank &bank) {
+
+    // The header and lengths, padded out to where the samples start.
+    std::vector<uint8_t> head(kDataOffset, 0);
+    SoundCacheHeader header {};
+    memcpy(header.magic, "PPSC", 4);
+    header.version = kCacheVersion;
+    header.appVersion = key.appVersion;
+    header.manifestHash = key.manifestHash;
+    header.contentHash = key.contentHash;
+    header.format = (uint32_t) key.format;
+    header.numChannels = key.numChannels;
+    header.sampleRate = key.sampleRate;
+    header.soundCount = (uint32_t) bank.getSoundCount();
+    header.dataSize = bank.getByteSize();
+    memcpy(head.data(), &header, sizeof(header));
+    for (int32_t sound = 0; sound < bank.getSoundCount(); sound++) {
+        auto numFrames = bank.getNumFrames(sound);
+        memcpy(head.data() + sizeof(header) + sound * sizeof(int32_t), &numFrames, sizeof(numFrames));
+    }
+
+    // Write beside the cache and swap it in, so the cache is either the old file or all of the new one.
+    auto tempPath = path + ".tmp";
+    auto file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    auto written = fwrite(head.data(), 1, head.size(), file) == head.size()
+            && fwrite(bank.getSamples(), 1, bank.getByteSize(), file) == bank.getByteSize();
+    written = fclose(file) == 0 && written;
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+
+}
+
+uint32_t SoundCache::hashManifest(const SoundBank &bank) {
+
+    // FNV-1a over each entry, with a separator so neighbouring paths can't run together.
+    uint32_t hash = 2166136261u;
+    auto add = [&hash](const void *data, size_t size) {
+        auto bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    for (int32_t sound = 0; sound < bank.getSoundCount(); sound++) {
+        auto &entry = bank.getEntry(sound);
+        add(&entry.group, sizeof(entry.group));
+        add(&entry.priority, sizeof(entry.priority));
+        add(entry.path.c_str(), entry.path.size() + 1);
+    }
+    return hash;
+
+}
+
+uint64_t SoundCache::hashBytes(uint64_t hash, const void *data, size_t size) {
+
+    // FNV-1a a word at a time, which keeps up with reading the sounds from storage.
+    static constexpr uint64_t kPrime = 1099511628211ull;
+    auto bytes = static_cast<const uint8_t *>(data);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * kPrime;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * kPrime;
+    }
+    return hash;
+
+}
@@ -0,0 +1,113 @@
+#ifndef PAT_PLAY_SOUNDCACHE_H
+#define PAT_PLAY_SOUNDCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SoundBank.h"
+#include "SoundBuffer.h"
+
+/*!
+ * What a cached arena was decoded for. A cache is only used if every field matches.
+ */
+struct SoundCacheKey {
+    // The app's version code. New sounds can ship under the same names in a new release.
+    uint32_t appVersion;
+
+    // Hash of the manifest's sounds, in order, see @a SoundCache::hashManifest.
+    uint32_t manifestHash;
+
+    // Hash of every sound's bundle entry or WAV header and length, see @a SoundCache::hashBytes.
+    // Builds without a version code hash every source byte instead, since they can change a sound
+    // in place.
+    uint64_t contentHash;
+
+    SampleFormat format;
+    int32_t numChannels;
+    int32_t sampleRate;
+};
+
+/*!
+ * A @a SoundBank arena saved to internal storage after the first launch, so later launches map
+ * it instead of decoding, converting and resampling every sound again.
+ *
+ * The file is checked against a key for the app version, manifest, sound headers and output
+ * format, and against every sound's measured length, then mapped read only. The bank plays
+ * straight from the mapping, which stays valid until the cache is unmapped.
+ *
+ * Layout: a header ("PPSC", version, the key, sound count, data size), each sound's length in
+ * frames, then the arena's samples starting 4096 bytes in. All values are little endian.
+ */
+class SoundCache {
+public:
+
+    // Where a hash of the sounds' contents starts, see @a hashBytes.
+    static constexpr uint64_t kEmptyHash = 14695981039346656037ull;
+
+    inline SoundCache(): data_(nullptr), size_(0), locked_(false) {}
+
+    inline ~SoundCache() {
+        unmap();
+    }
+
+    SoundCache(const SoundCache &) = delete;
+    SoundCache &operator=(const SoundCache &) = delete;
+
+    /*!
+     * Maps a cache file and checks it matches, then reads it through and locks it in memory, so
+     * the audio thread doesn't wait on storage when a sound plays. Locking is best effort. Pages
+     * that couldn't be locked may be dropped under memory pressure and read back in by the audio
+     * thread.
+     * @param path The cache file
+     * @param key What the arena needs to have been decoded for
+     * @param numFrames The length each sound should have, in manifest order
+     * @return false if there's no cache, or it doesn't match
+     */
+    bool map(const std::string &path, const SoundCacheKey &key, const std::vector<int32_t> &numFrames);
+
+    void unmap();
+
+    inline bool isMapped() const { return data_ != nullptr; }
+
+    /*!
+     * @return the arena's samples, laid out as @a SoundBank::allocate would
+     */
+    const void *getSamples() const;
+
+    /*!
+     * @return the bytes of sample data mapped
+     */
+    size_t getByteSize() const;
+
+    /*!
+     * Saves a bank's arena, replacing any cache there. The file only appears once it's complete,
+     * so an app killed part way through never leaves a broken cache behind.
+     * @param path The cache file
+     * @param key What the arena was decoded for
+     * @param bank A bank with every sound published
+     * @return false if the file can't be written
+     */
+    static bool write(const std::string &path, const SoundCacheKey &key, const SoundBank &bank);
+
+    /*!
+     * @return a hash of every sound's group, priority and path, in order
+     */
+    static uint32_t hashManifest(const SoundBank &bank);
+
+    /*!
+     * Adds bytes to a running hash of the sounds' contents. Fast rather than strong, since it
+     * only has to notice a sound changing between builds.
+     * @param hash The hash so far, or @a kEmptyHash to start
+     * @return the new hash
+     */
+    static uint64_t hashBytes(uint64_t hash, const void *data, size_t size);
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    bool locked_;
+};
+
+#endif //PAT_PLAY_SOUNDCACHE_H
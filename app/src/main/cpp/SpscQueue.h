@@ -0,0 +1,55 @@
+#ifndef PAT_PLAY_SPSCQUEUE_H
+#define PAT_PLAY_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/*!
+ * Fixed capacity, wait-free queue for one producer thread and one consumer thread.
+ *
+ * Neither side allocates, locks or spins, so it is safe to use from the audio callback. @a push
+ * fails instead of blocking when the queue is full.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    inline SpscQueue(): head_(0), tail_(0), items_() {}
+
+    /*!
+     * Adds an item. Only call this from the producer thread.
+     * @return false if the queue was full and the item was dropped
+     */
+    inline bool push(const T &item) {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+     * Takes the oldest item. Only call this from the consumer thread.
+     * @return false if the queue was empty
+     */
+    inline bool pop(T &item) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Each index lives on its own cache line so the two threads don't fight over one.
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+    alignas(64) T items_[Capacity];
+};
+
+#endif //PAT_PLAY_SPSCQUEUE_H
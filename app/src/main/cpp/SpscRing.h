@@ -0,0 +1,123 @@
+#ifndef PAT_PLAY_SPSCRING_H
+#define PAT_PLAY_SPSCRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/*!
+ * Wait-free ring buffer of samples for one producer thread and one consumer thread, moving blocks
+ * of them at a time rather than one item like @a SpscQueue.
+ *
+ * The storage is allocated up front, so neither side allocates, locks or spins and either can be
+ * the audio callback. Reads and writes move as much as fits rather than blocking.
+ */
+template <typename T>
+class SpscRing {
+public:
+
+    /*!
+     * @param capacity The most samples held at once, rounded up to a power of two
+     */
+    inline explicit SpscRing(size_t capacity): head_(0), tail_(0), discard_(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        items_.resize(size);
+    }
+
+    inline size_t getCapacity() const { return items_.size(); }
+
+    /*!
+     * @return the samples that can be written without overwriting unread ones. Only call this from
+     * the producer thread.
+     */
+    inline size_t getWriteAvailable() const {
+        return getCapacity() - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+    }
+
+    /*!
+     * @return the samples waiting to be read. Safe from either thread, though only the consumer
+     * sees an exact count.
+     */
+    inline size_t getReadAvailable() const {
+        auto tail = std::max(tail_.load(std::memory_order_acquire), discard_.load(std::memory_order_acquire), isBehind);
+        return head_.load(std::memory_order_acquire) - tail;
+    }
+
+    /*!
+     * Appends samples. Only call this from the producer thread.
+     * @return how many were written, fewer than @a count if the ring filled up
+     */
+    inline size_t write(const T *data, size_t count) {
+        auto head = head_.load(std::memory_order_relaxed);
+        count = std::min(count, getWriteAvailable());
+        forEachRun(head, count, [&](size_t offset, size_t i, size_t n) {
+            memcpy(&items_[offset], data + i, n * sizeof(T));
+        });
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /*!
+     * Takes the oldest samples. Only call this from the consumer thread.
+     * @return how many were read, fewer than @a count if the ring ran dry
+     */
+    inline size_t read(T *data, size_t count) {
+        auto tail = std::max(tail_.load(std::memory_order_relaxed), discard_.load(std::memory_order_acquire), isBehind);
+        count = std::min(count, head_.load(std::memory_order_acquire) - tail);
+        forEachRun(tail, count, [&](size_t offset, size_t i, size_t n) {
+            memcpy(data + i, &items_[offset], n * sizeof(T));
+        });
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /*!
+     * Throws away everything written so far, without waiting for the consumer. Only call this
+     * from the producer thread. The consumer skips the samples on its next read.
+     */
+    inline void discardWritten() {
+        discard_.store(head_.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+private:
+
+    /*!
+     * Whether position @a a comes before @a b, allowing for the counters wrapping.
+     */
+    static inline bool isBehind(size_t a, size_t b) {
+        return (ptrdiff_t) (a - b) < 0;
+    }
+
+    /*!
+     * Calls @a move for the one or two runs that @a count samples from @a position cover, with
+     * the ring offset, the offset into the caller's data and the run length.
+     */
+    template <typename Move>
+    inline void forEachRun(size_t position, size_t count, Move &&move) {
+        auto mask = getCapacity() - 1;
+        auto offset = position & mask;
+        auto first = std::min(count, getCapacity() - offset);
+        move(offset, 0, first);
+        if (first < count) {
+            move(0, first, count - first);
+        }
+    }
+
+    // Each position lives on its own cache line so the two threads don't fight over one. They
+    // count samples ever written and read, and only wrap at the size_t limit.
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+
+    // Everything before this position was thrown away by the producer.
+    alignas(64) std::atomic<size_t> discard_;
+
+    std::vector<T> items_;
+
+};
+
+#endif //PAT_PLAY_SPSCRING_H
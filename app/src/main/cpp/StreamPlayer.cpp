@@ -0,0 +1,197 @@
+#include "StreamPlayer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Mix.h"
+
+// Frames of the source read and decoded at a time.
+static constexpr int32_t kChunkFrames = 1024;
+
+// Frames the audio thread copies out of the ring at a time.
+static constexpr int32_t kMixFrames = 1024;
+
+// How often the prefetch thread checks whether the ring has room, well inside the time the ring
+// lasts at any sensible buffer size.
+static constexpr auto kRefillInterval = std::chrono::milliseconds(10);
+
+StreamPlayer::StreamPlayer(int32_t numChannels, int32_t sampleRate, int32_t bufferFrames):
+        numChannels_(numChannels),
+        sampleRate_(sampleRate),
+        ring_((size_t) bufferFrames * numChannels),
+        playing_(false),
+        gain_(0.0f),
+        underruns_(0),
+        hasPending_(false),
+        loopPending_(false),
+        gainPending_(0.0f),
+        quit_(false),
+        phase_(0.0),
+        mixBuffer_((size_t) kMixFrames * numChannels),
+        thread_(&StreamPlayer::prefetch, this) {}
+
+StreamPlayer::~StreamPlayer() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+
+}
+
+void StreamPlayer::play(std::unique_ptr<WaveStream> stream, bool loop, float gain) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = std::move(stream);
+        hasPending_ = true;
+        loopPending_ = loop;
+        gainPending_ = gain;
+    }
+    wake_.notify_one();
+
+}
+
+void StreamPlayer::mix(float *outputBuffer, int32_t numFrames, int32_t numChannels) {
+
+    if (numChannels != numChannels_) {
+        return;
+    }
+
+    // The prefetch thread only ever writes whole frames, so reads always come out whole too.
+    auto gain = gain_.load(std::memory_order_relaxed);
+    auto wanted = (size_t) numFrames * numChannels;
+    size_t done = 0;
+    while (done < wanted) {
+        auto count = ring_.read(mixBuffer_.data(), std::min(wanted - done, mixBuffer_.size()));
+        if (count == 0) {
+            break;
+        }
+        mixFrames(outputBuffer + done, mixBuffer_.data(), (int32_t) (count / numChannels), numChannels, gain, 0.0f);
+        done += count;
+    }
+
+    // Running dry is only an underrun while there's more of the stream to come.
+    if (done < wanted && playing_.load(std::memory_order_relaxed)) {
+        underruns_.store(underruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+}
+
+void StreamPlayer::prefetch() {
+
+    std::unique_ptr<WaveStream> stream;
+    auto loop = false;
+
+    // How much of the converted chunk is already in the ring.
+    size_t written = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!quit_) {
+
+        // Swap in a new stream, dropping whatever the old one had buffered.
+        if (hasPending_) {
+            stream = std::move(pending_);
+            loop = loopPending_;
+            hasPending_ = false;
+            ring_.discardWritten();
+            gain_.store(gainPending_, std::memory_order_relaxed);
+            playing_.store(stream != nullptr, std::memory_order_relaxed);
+            converted_.clear();
+            written = 0;
+            phase_ = 0.0;
+            previousFrame_.assign(numChannels_, 0.0f);
+        }
+        if (!stream) {
+            wake_.wait(lock, [this]() { return quit_ || hasPending_; });
+            continue;
+        }
+
+        // Top up the ring without the lock, so a new stream can be handed over meanwhile.
+        lock.unlock();
+        auto ended = false;
+        while (true) {
+            auto room = ring_.getWriteAvailable() / numChannels_ * numChannels_;
+            if (room == 0) {
+                break;
+            }
+            if (written == converted_.size()) {
+                written = 0;
+                if (decodeChunk(*stream) == 0 && !(loop && stream->rewind() && decodeChunk(*stream) > 0)) {
+                    ended = true;
+                    break;
+                }
+            }
+            written += ring_.write(converted_.data() + written, std::min(room, converted_.size() - written));
+        }
+        lock.lock();
+
+        if (ended) {
+            stream.reset();
+            playing_.store(false, std::memory_order_relaxed);
+        } else {
+            wake_.wait_for(lock, kRefillInterval, [this]() { return quit_ || hasPending_; });
+        }
+
+    }
+
+}
+
+int32_t StreamPlayer::decodeChunk(WaveStream &stream) {
+
+    auto sourceChannels = stream.getNumChannels();
+    decoded_.resize((size_t) kChunkFrames * sourceChannels);
+    auto frames = stream.read(decoded_.data(), kChunkFrames);
+    converted_.clear();
+    if (frames <= 0) {
+        return 0;
+    }
+
+    // Match the output's channels the same way SoundBuffer does: fewer source channels repeat
+    // across the output, and extra ones are averaged in.
+    remixed_.resize((size_t) frames * numChannels_);
+    for (int32_t f = 0; f < frames; f++) {
+        auto *frame = &decoded_[(size_t) f * sourceChannels];
+        for (int32_t c = 0; c < numChannels_; c++) {
+            if (sourceChannels <= numChannels_) {
+                remixed_[(size_t) f * numChannels_ + c] = frame[c % sourceChannels];
+            } else {
+                float sum = 0.0f;
+                int32_t count = 0;
+                for (int32_t s = c; s < sourceChannels; s += numChannels_, count++) {
+                    sum += frame[s];
+                }
+                remixed_[(size_t) f * numChannels_ + c] = sum / (float) count;
+            }
+        }
+    }
+
+    if (stream.getSampleRate() == sampleRate_) {
+        converted_.swap(remixed_);
+        return frames;
+    }
+
+    // Linear interpolation, carrying the position and the last frame over between chunks. Rough
+    // next to the Resampler sounds are loaded with, but that one needs the whole sound at once.
+    // Positions from -1 to 0 fall between the previous chunk's last frame and this one's first.
+    auto step = (double) stream.getSampleRate() / (double) sampleRate_;
+    converted_.reserve((size_t) (std::ceil(frames / step) + 1) * numChannels_);
+    while (phase_ < frames - 1) {
+        auto index = (int32_t) std::floor(phase_);
+        auto fraction = (float) (phase_ - index);
+        auto *a = index < 0 ? previousFrame_.data() : &remixed_[(size_t) index * numChannels_];
+        auto *b = &remixed_[(size_t) (index + 1) * numChannels_];
+        for (int32_t c = 0; c < numChannels_; c++) {
+            converted_.push_back(a[c] + (b[c] - a[c]) * fraction);
+        }
+        phase_ += step;
+    }
+    phase_ -= frames;
+    previousFrame_.assign(remixed_.end() - numChannels_, remixed_.end());
+
+    return frames;
+
+}
@@ -0,0 +1,109 @@
+#ifndef PAT_PLAY_STREAMPLAYER_H
+#define PAT_PLAY_STREAMPLAYER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+#include "WaveStream.h"
+
+/*!
+ * Plays a @a WaveStream through the mixer without the audio callback ever touching the file.
+ *
+ * A prefetch thread decodes the stream a chunk at a time, converts it to the output's channel
+ * count and rate, and keeps a ring buffer topped up. The audio callback only copies out of the
+ * ring, and if the ring ever runs dry it plays silence and counts an underrun rather than wait.
+ */
+class StreamPlayer {
+public:
+
+    // About a third of a second at 48kHz, plenty to ride out a slow read.
+    static constexpr int32_t kDefaultBufferFrames = 16384;
+
+    /*!
+     * @param numChannels Channels of the output
+     * @param sampleRate Rate of the output
+     * @param bufferFrames Frames decoded ahead of the audio callback
+     */
+    StreamPlayer(int32_t numChannels, int32_t sampleRate, int32_t bufferFrames = kDefaultBufferFrames);
+
+    ~StreamPlayer();
+
+    /*!
+     * Starts playing a stream from its current position, replacing whatever was playing. Safe
+     * from any thread but the audio one.
+     * @param stream The stream to play, or null to stop
+     * @param loop Whether to go back to the start at the end
+     * @param gain How loud to mix it
+     */
+    void play(std::unique_ptr<WaveStream> stream, bool loop, float gain);
+
+    /*!
+     * Stops playing. Safe from any thread but the audio one.
+     */
+    inline void stop() { play(nullptr, false, 0.0f); }
+
+    /*!
+     * Adds the next buffered frames into an interleaved buffer. Only call this from the audio
+     * thread. Never blocks.
+     */
+    void mix(float *outputBuffer, int32_t numFrames, int32_t numChannels);
+
+    /*!
+     * @return how many times the audio thread found fewer frames ready than it needed
+     */
+    inline uint32_t getUnderruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+private:
+
+    /*!
+     * Keeps the ring full until told to quit. Runs on the prefetch thread.
+     */
+    void prefetch();
+
+    /*!
+     * Reads and converts the next chunk of @a stream into @a converted_.
+     * @return the output frames made, or 0 at the end of the stream
+     */
+    int32_t decodeChunk(WaveStream &stream);
+
+    int32_t numChannels_;
+    int32_t sampleRate_;
+
+    // Frames mixed in, in the output's channel count and rate.
+    SpscRing<float> ring_;
+
+    // Set by the prefetch thread while a stream is playing and hasn't reached its end.
+    std::atomic<bool> playing_;
+    std::atomic<float> gain_;
+    std::atomic<uint32_t> underruns_;
+
+    // Hands a new stream over to the prefetch thread.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::unique_ptr<WaveStream> pending_;
+    bool hasPending_;
+    bool loopPending_;
+    float gainPending_;
+    bool quit_;
+
+    // Used by the prefetch thread only.
+    std::vector<float> decoded_;
+    std::vector<float> remixed_;
+    std::vector<float> converted_;
+    std::vector<float> previousFrame_;
+    double phase_;
+
+    // Used by the audio thread only.
+    std::vector<float> mixBuffer_;
+
+    std::thread thread_;
+
+};
+
+#endif //PAT_PLAY_STREAMPLAYER_H
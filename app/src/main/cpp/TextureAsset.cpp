@@ -3,7 +3,7 @@
 #include "AndroidOut.h"
 #include "Utility.h"
 
-std::shared_ptr<TextureAsset>
+TextureAsset
 TextureAsset::loadAsset(AAssetManager *assetManager, const std::string &assetPath, int removeWhiteOrBlack) {
     // Get the image from asset manager
     auto pAndroidRobotPng = AAssetManager_open(
@@ -15,16 +15,28 @@ TextureAsset::loadAsset(AAssetManager *assetManager, const std::string &assetPat
     AImageDecoder *pAndroidDecoder = nullptr;
     auto result = AImageDecoder_createFromAAsset(pAndroidRobotPng, &pAndroidDecoder);
     if (result != ANDROID_IMAGE_DECODER_SUCCESS) {
-        return std::shared_ptr<TextureAsset>(new TextureAsset(0));
+        return TextureAsset(0, 0);
     }
 
-    // make sure we get 8 bits per channel out. RGBA order.
-    AImageDecoder_setAndroidBitmapFormat(pAndroidDecoder, ANDROID_BITMAP_FORMAT_RGBA_8888);
-
     // Get the image header, to help set everything up
     const AImageDecoderHeaderInfo *pAndroidHeader = nullptr;
     pAndroidHeader = AImageDecoder_getHeaderInfo(pAndroidDecoder);
 
+    // Pick the smallest format that holds what we need.
+    // Opaque images with nothing keyed out don't need alpha, so they can be decoded straight to
+    // 565. Everything else is decoded as 8 bits per channel, RGBA order, and the glyph masks are
+    // packed down to a single channel after keying.
+    auto opaque = AImageDecoderHeaderInfo_getAlphaFlags(pAndroidHeader) == ANDROID_BITMAP_FLAGS_ALPHA_OPAQUE;
+    auto format = TextureFormat::RGBA8;
+    if (removeWhiteOrBlack == 2) {
+        format = TextureFormat::R8;
+    } else if (removeWhiteOrBlack == 0 && opaque) {
+        format = TextureFormat::RGB565;
+    }
+    AImageDecoder_setAndroidBitmapFormat(
+            pAndroidDecoder,
+            format == TextureFormat::RGB565 ? ANDROID_BITMAP_FORMAT_RGB_565 : ANDROID_BITMAP_FORMAT_RGBA_8888);
+
     // important metrics for sending to GL
     auto width = AImageDecoderHeaderInfo_getWidth(pAndroidHeader);
     auto height = AImageDecoderHeaderInfo_getHeight(pAndroidHeader);
@@ -46,9 +58,32 @@ TextureAsset::loadAsset(AAssetManager *assetManager, const std::string &assetPat
 
     // Check result.
     if (decodeResult != ANDROID_IMAGE_DECODER_SUCCESS) {
-        return std::shared_ptr<TextureAsset>(new TextureAsset(0));
+        return TextureAsset(0, 0);
     }
 
+    // Make every white pixel transparent.
+    // This is a pat play thing.
+    if (removeWhiteOrBlack == 1) {
+        for (auto i = 0; i < size; i += 4) {
+            if (data[i] > 0xf0 && data[i + 1] > 0xf0 && data[i + 2] > 0xf0) {
+                data[i + 3] = 0;
+            }
+        }
+    } else if (removeWhiteOrBlack == 2) {
+        // Meant just for the font files. Black pixels become the mask, everything else is clear.
+        // Packing in place is safe, as each output byte is never ahead of the pixel it reads.
+        auto count = width * height;
+        for (auto i = 0; i < count; i++) {
+            auto pixel = data + (i / width) * stride + (i % width) * 4;
+            data[i] = pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 0 ? 0xff : 0;
+        }
+    }
+
+    return loadPixels(format, width, height, data);
+}
+
+TextureAsset
+TextureAsset::loadPixels(TextureFormat format, int width, int height, const void *data) {
     // Get an opengl texture
     GLuint textureId;
     glGenTextures(1, &textureId);
@@ -61,49 +96,59 @@ TextureAsset::loadAsset(AAssetManager *assetManager, const std::string &assetPat
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Make every white pixel transparent.
-    // This is a pat play thing.
-    if (removeWhiteOrBlack == 1) {
-        for (auto i = 0; i < size; i += 4) {
-            if (data[i] > 0xf0 && data[i + 1] > 0xf0 && data[i + 2] > 0xf0) {
-                data[i + 3] = 0;
-            }
-        }
-    } else if (removeWhiteOrBlack == 2) {
-        // Meant just for the font files. Invert and remove white. Lol.
-        for (auto i = 0; i < size; i += 4) {
-            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 0) {
-                data[i] = 0xff;
-                data[i + 1] = 0xff;
-                data[i + 2] = 0xff;
-            } else {
-                data[i + 3] = 0;
-            }
-        }
+    GLint internalFormat;
+    GLenum pixelFormat;
+    GLenum type;
+    size_t bytesPerPixel;
+    switch (format) {
+        case TextureFormat::RGB565:
+            internalFormat = GL_RGB565;
+            pixelFormat = GL_RGB;
+            type = GL_UNSIGNED_SHORT_5_6_5;
+            bytesPerPixel = 2;
+            break;
+        case TextureFormat::R8:
+            internalFormat = GL_R8;
+            pixelFormat = GL_RED;
+            type = GL_UNSIGNED_BYTE;
+            bytesPerPixel = 1;
+
+            // Expand the mask to white with the mask as alpha when sampled, so the shader sees
+            // the same thing it would from an RGBA texture.
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ONE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+            break;
+        case TextureFormat::RGBA8:
+        default:
+            internalFormat = GL_RGBA8;
+            pixelFormat = GL_RGBA;
+            type = GL_UNSIGNED_BYTE;
+            bytesPerPixel = 4;
+            break;
     }
 
+    // Rows are tightly packed, which isn't 4 byte aligned for the smaller formats
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
     // Load the texture into VRAM
     glTexImage2D(
             GL_TEXTURE_2D, // target
             0, // mip level
-            GL_RGBA, // internal format, often advisable to use BGR
+            internalFormat, // internal format
             width, // width of the texture
             height, // height of the texture
             0, // border (always 0)
-            GL_RGBA, // format
-            GL_UNSIGNED_BYTE, // type
+            pixelFormat, // format
+            type, // type
             data // Data to upload
     );
 
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
     // generate mip levels. Not really needed for 2D, but good to do
     // glGenerateMipmap(GL_TEXTURE_2D);
 
-    // Create a shared pointer so it can be cleaned up easily/automatically
-    return std::shared_ptr<TextureAsset>(new TextureAsset(textureId));
+    return TextureAsset(textureId, (size_t) width * height * bytesPerPixel);
 }
-
-TextureAsset::~TextureAsset() {
-    // return texture resources
-    glDeleteTextures(1, &textureID_);
-    textureID_ = 0;
-}
\ No newline at end of file
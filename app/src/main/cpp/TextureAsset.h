@@ -7,28 +7,70 @@
 #include <string>
 #include <vector>
 
+/*!
+ * The layouts texture data can be stored in on the GPU. The values are also stored in asset bundles.
+ */
+enum class TextureFormat {
+    RGBA8 = 0,  // 4 bytes per pixel, for images that need alpha.
+    RGB565 = 1, // 2 bytes per pixel, for opaque images.
+    R8 = 2,     // 1 byte per pixel, for masks. Sampled as white with the mask as alpha.
+};
+
+/*!
+ * @return the bytes a pixel takes in @a format, or 0 if it isn't a format we know
+ */
+constexpr size_t getBytesPerPixel(TextureFormat format) {
+    switch (format) {
+        case TextureFormat::RGBA8:
+            return 4;
+        case TextureFormat::RGB565:
+            return 2;
+        case TextureFormat::R8:
+            return 1;
+    }
+    return 0;
+}
+
+/*!
+ * A texture uploaded to VRAM. This doesn't own the GL texture, whoever loads it is responsible for
+ * deleting it, usually by handing it to @a GpuResources.
+ */
 class TextureAsset {
 public:
     /*!
      * Loads a texture asset from the assets/ directory
      * @param assetManager Asset manager to use
      * @param assetPath The path to the asset
-     * @return a shared pointer to a texture asset, resources will be reclaimed when it's cleaned up
+     * @return the loaded texture, with a texture id of 0 if loading failed
      */
-    static std::shared_ptr<TextureAsset>
+    static TextureAsset
     loadAsset(AAssetManager *assetManager, const std::string &assetPath, int removeWhiteOrBlack);
 
-    ~TextureAsset();
+    /*!
+     * Creates a texture from pixels that have already been decoded and processed
+     * @param format The layout of @a data, also used as the texture's format
+     * @param data Tightly packed rows of pixels
+     * @return the loaded texture
+     */
+    static TextureAsset
+    loadPixels(TextureFormat format, int width, int height, const void *data);
 
     /*!
      * @return the texture id for use with OpenGL
      */
     constexpr GLuint getTextureID() const { return textureID_; }
 
+    /*!
+     * @return the number of bytes this texture occupies in VRAM
+     */
+    constexpr size_t getByteSize() const { return byteSize_; }
+
 private:
-    inline TextureAsset(GLuint textureId) : textureID_(textureId) {}
+    constexpr TextureAsset(GLuint textureId, size_t byteSize)
+            : textureID_(textureId), byteSize_(byteSize) {}
 
     GLuint textureID_;
+    size_t byteSize_;
 };
 
-#endif //ANDROIDGLINVESTIGATIONS_TEXTUREASSET_H
\ No newline at end of file
+#endif //ANDROIDGLINVESTIGATIONS_TEXTUREASSET_H
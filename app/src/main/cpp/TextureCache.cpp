@@ -0,0 +1,148 @@
+#include "TextureCache.h"
+
+#include "AndroidOut.h"
+
+void TextureCache::init(AAssetManager *assetManager, const AssetBundle *bundle, GpuResources *resources) {
+    assetManager_ = assetManager;
+    bundle_ = bundle;
+    resources_ = resources;
+}
+
+GpuHandle TextureCache::acquire(const std::string &assetPath, int removeWhiteOrBlack) {
+
+    // Entries outlive eviction, so an evicted texture is simply reloaded here.
+    Key key(assetPath, removeWhiteOrBlack);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        it = entries_.emplace(key, Entry { resources_->add(GpuResourceKind::Texture, 0), false, 0, 0, 0 }).first;
+    }
+
+    auto &entry = it->second;
+    entry.references++;
+    entry.lastUsed = ++clock_;
+    if (!entry.resident) {
+        upload(key, entry);
+
+        // The new texture is referenced now, so it can't be the one evicted.
+        trimToBudget();
+    }
+
+    return entry.handle;
+
+}
+
+void TextureCache::release(GpuHandle texture) {
+    for (auto &it : entries_) {
+        auto &entry = it.second;
+        if (entry.handle.index == texture.index && entry.handle.generation == texture.generation) {
+            if (entry.references > 0) {
+                entry.references--;
+            }
+            return;
+        }
+    }
+}
+
+size_t TextureCache::evictUnused() {
+    auto before = bytesResident_;
+    for (auto &it : entries_) {
+        if (isUnused(it.second)) {
+            evict(it.second);
+        }
+    }
+    return before - bytesResident_;
+}
+
+void TextureCache::reloadUnused() {
+    for (auto &it : entries_) {
+        if (isUnused(it.second)) {
+            evict(it.second);
+            upload(it.first, it.second);
+        }
+    }
+}
+
+void TextureCache::reloadAll() {
+    for (auto &it : entries_) {
+        evict(it.second);
+        if (it.second.references > 0) {
+            upload(it.first, it.second);
+        }
+    }
+}
+
+void TextureCache::setBudget(size_t bytes) {
+    budgetBytes_ = bytes;
+    trimToBudget();
+}
+
+void TextureCache::clear() {
+    for (auto &it : entries_) {
+        resources_->destroy(it.second.handle);
+    }
+    entries_.clear();
+    bytesResident_ = 0;
+}
+
+TextureAsset TextureCache::loadTexture(const Key &key) const {
+
+    // Prefer the bundle, which has already been decoded and keyed.
+    if (bundle_ && bundle_->isOpen()) {
+        auto entry = bundle_->find(key.first, BundleEntryKind::Texture);
+        if (entry && entry->mode == (uint32_t) key.second) {
+            return TextureAsset::loadPixels(
+                    (TextureFormat) entry->format,
+                    (int) entry->width,
+                    (int) entry->height,
+                    bundle_->getData(*entry));
+        }
+    }
+
+    return TextureAsset::loadAsset(assetManager_, key.first, key.second);
+
+}
+
+void TextureCache::upload(const Key &key, Entry &entry) {
+    auto texture = loadTexture(key);
+
+    // A failed load isn't resident, so it's tried again on the next acquire rather than cached.
+    if (texture.getTextureID() == 0) {
+        aout << "Failed to load texture " << key.first << std::endl;
+        return;
+    }
+    resources_->replace(entry.handle, texture.getTextureID());
+    entry.resident = true;
+    entry.bytes = texture.getByteSize();
+    bytesResident_ += entry.bytes;
+}
+
+void TextureCache::evict(Entry &entry) {
+    if (entry.resident) {
+        resources_->replace(entry.handle, 0);
+        bytesResident_ -= entry.bytes;
+        entry.resident = false;
+        entry.bytes = 0;
+    }
+}
+
+void TextureCache::trimToBudget() {
+    if (budgetBytes_ == 0) {
+        return;
+    }
+
+    // Evict the least recently used unreferenced texture until we fit.
+    // There are only a handful of textures, so a linear scan is fine.
+    while (bytesResident_ > budgetBytes_) {
+        Entry *oldest = nullptr;
+        for (auto &it : entries_) {
+            if (isUnused(it.second) && (!oldest || it.second.lastUsed < oldest->lastUsed)) {
+                oldest = &it.second;
+            }
+        }
+        if (!oldest) {
+            aout << "Texture budget exceeded by in-use textures: " << bytesResident_ << " bytes" << std::endl;
+            return;
+        }
+        evict(*oldest);
+    }
+}
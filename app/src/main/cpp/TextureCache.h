@@ -0,0 +1,115 @@
+#ifndef PAT_PLAY_TEXTURECACHE_H
+#define PAT_PLAY_TEXTURECACHE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <android/asset_manager.h>
+
+#include "AssetBundle.h"
+#include "GpuResources.h"
+#include "TextureAsset.h"
+
+/*!
+ * Owns every texture loaded from the assets/ directory. Loads are keyed by asset path and
+ * processing mode, so asking for the same image twice hands back the same texture.
+ *
+ * Textures are reference counted through @a acquire and @a release. Once nothing holds a reference
+ * a texture may be evicted, and it is transparently reloaded the next time it's acquired. Handles
+ * stay the same across eviction and reloading.
+ */
+class TextureCache {
+public:
+    inline TextureCache():
+            assetManager_(nullptr),
+            bundle_(nullptr),
+            resources_(nullptr),
+            budgetBytes_(0),
+            bytesResident_(0),
+            clock_(0) {}
+
+    /*!
+     * @param assetManager Asset manager used for loads the bundle can't serve
+     * @param bundle Pre-processed textures to prefer over decoding assets, may be null
+     * @param resources Registry that owns the GL textures
+     */
+    void init(AAssetManager *assetManager, const AssetBundle *bundle, GpuResources *resources);
+
+    /*!
+     * Gets a texture, loading it if it isn't resident, and adds a reference to it.
+     * @param assetPath The path to the asset
+     * @param removeWhiteOrBlack The processing mode, see @a TextureAsset::loadAsset
+     * @return a handle to the texture
+     */
+    GpuHandle acquire(const std::string &assetPath, int removeWhiteOrBlack);
+
+    /*!
+     * Drops a reference taken by @a acquire. The texture stays resident until evicted.
+     */
+    void release(GpuHandle texture);
+
+    /*!
+     * Frees every resident texture that nothing references.
+     * @return the number of bytes freed
+     */
+    size_t evictUnused();
+
+    /*!
+     * Reloads every resident texture that nothing references.
+     */
+    void reloadUnused();
+
+    /*!
+     * Reloads every texture that is referenced, and drops the rest. Use this after the registry
+     * has abandoned its objects because the context was lost.
+     */
+    void reloadAll();
+
+    /*!
+     * Sets the soft limit on resident texture memory. When a load takes the cache over budget, the
+     * least recently used unreferenced textures are evicted until it fits again. 0 means no limit.
+     */
+    void setBudget(size_t bytes);
+
+    /*!
+     * Destroys every texture, invalidating all handles handed out.
+     */
+    void clear();
+
+    /*!
+     * @return the number of bytes of texture data resident in VRAM
+     */
+    inline size_t getBytesResident() const { return bytesResident_; }
+
+private:
+    using Key = std::pair<std::string, int>;
+
+    struct Entry {
+        GpuHandle handle;
+        bool resident;
+        size_t bytes;
+        int references;
+        uint64_t lastUsed;
+    };
+
+    static inline bool isUnused(const Entry &entry) {
+        return entry.resident && entry.references == 0;
+    }
+
+    TextureAsset loadTexture(const Key &key) const;
+    void upload(const Key &key, Entry &entry);
+    void evict(Entry &entry);
+    void trimToBudget();
+
+    AAssetManager *assetManager_;
+    const AssetBundle *bundle_;
+    GpuResources *resources_;
+    size_t budgetBytes_;
+    size_t bytesResident_;
+    uint64_t clock_;
+    std::map<Key, Entry> entries_;
+};
+
+#endif //PAT_PLAY_TEXTURECACHE_H
@@ -6,11 +6,21 @@
 #define PAT_PLAY_TIME_H
 
 #include <chrono>
+#include <cstdint>
 
 using Clock = std::chrono::system_clock;
 using Seconds = std::chrono::duration<double>;
 using TimePoint = std::chrono::time_point<Clock, Seconds>;
 
+/*!
+ * Gets the time on the monotonic clock, the one audio stream timestamps use.
+ * @return the time in nanoseconds.
+ */
+inline int64_t nowNanos() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
 class Time {
 public:
 
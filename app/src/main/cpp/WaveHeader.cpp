@@ -0,0 +1,112 @@
+#include "WaveHeader.h"
+
+#include <cstring>
+
+static inline uint32_t readUint32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+static inline uint16_t readUint16(const uint8_t *data) {
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+// The 14 bytes an extensible format's subformat GUID ends in for the standard formats. The first
+// two bytes are the format code.
+static constexpr uint8_t kSubFormatSuffix[14] = {
+        0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+static inline void writeUint32(uint8_t *data, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        data[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+static inline void writeUint16(uint8_t *data, uint16_t value) {
+    data[0] = (uint8_t) value;
+    data[1] = (uint8_t) (value >> 8);
+}
+
+bool parseWaveHeader(const uint8_t *data, size_t size, WaveHeader &header) {
+
+    if (!data || size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    // Chunks are an ID, a little endian size, then the body padded to an even length. The format
+    // chunk always comes before the data.
+    auto foundFormat = false;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        auto chunk = data + offset;
+        size_t chunkSize = readUint32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || offset + 8 + 16 > size) {
+                return false;
+            }
+            header.audioFormat = readUint16(chunk + 8);
+            header.numChannels = readUint16(chunk + 10);
+            header.sampleRate = (int32_t) readUint32(chunk + 12);
+            header.bitDepth = readUint16(chunk + 22);
+
+            // An extensible file says what its samples really are in the subformat GUID.
+            if (header.audioFormat == 0xFFFE) {
+                if (chunkSize < 40 || offset + 8 + 40 > size || memcmp(chunk + 34, kSubFormatSuffix, sizeof(kSubFormatSuffix)) != 0) {
+                    return false;
+                }
+                header.audioFormat = readUint16(chunk + 32);
+            }
+            foundFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!foundFormat) {
+                return false;
+            }
+            header.dataOffset = offset + 8;
+            header.dataSize = chunkSize;
+            break;
+        }
+
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (!foundFormat || offset + 8 > size) {
+        return false;
+    }
+
+    auto bitDepth = header.bitDepth;
+    auto supportedDepth = bitDepth == 8 || bitDepth == 16 || bitDepth == 24 || bitDepth == 32;
+    auto supportedFormat = header.audioFormat == 1 || (header.audioFormat == 3 && bitDepth == 32);
+    return supportedDepth && supportedFormat && header.numChannels > 0 && header.sampleRate > 0;
+
+}
+
+size_t writeWaveHeader(const WaveHeader &header, uint8_t *data) {
+
+    // Formats other than integer PCM have an extension size in the format chunk, even if empty.
+    uint32_t formatSize = header.audioFormat == 1 ? 16 : 18;
+    size_t size = 12 + 8 + formatSize + 8;
+
+    memcpy(data, "RIFF", 4);
+    writeUint32(data + 4, (uint32_t) (size - 8 + header.dataSize));
+    memcpy(data + 8, "WAVE", 4);
+
+    auto format = data + 12;
+    memcpy(format, "fmt ", 4);
+    writeUint32(format + 4, formatSize);
+    writeUint16(format + 8, (uint16_t) header.audioFormat);
+    writeUint16(format + 10, (uint16_t) header.numChannels);
+    writeUint32(format + 12, (uint32_t) header.sampleRate);
+    writeUint32(format + 16, (uint32_t) (header.sampleRate * header.getBytesPerFrame()));
+    writeUint16(format + 20, (uint16_t) header.getBytesPerFrame());
+    writeUint16(format + 22, (uint16_t) header.bitDepth);
+    if (formatSize > 16) {
+        writeUint16(format + 24, 0);
+    }
+
+    auto dataChunk = format + 8 + formatSize;
+    memcpy(dataChunk, "data", 4);
+    writeUint32(dataChunk + 4, (uint32_t) header.dataSize);
+
+    return size;
+
+}
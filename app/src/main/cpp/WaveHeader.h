@@ -0,0 +1,48 @@
+#ifndef PAT_PLAY_WAVEHEADER_H
+#define PAT_PLAY_WAVEHEADER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * The format and data location of a RIFF WAVE file, read without decoding any samples.
+ */
+struct WaveHeader {
+    // 1 for integer PCM or 3 for IEEE float. An extensible file is read as the format its
+    // subformat names.
+    int32_t audioFormat;
+
+    int32_t numChannels;
+    int32_t sampleRate;
+    int32_t bitDepth;
+
+    // Where the sample data starts in the file, and its length in bytes.
+    size_t dataOffset;
+    size_t dataSize;
+
+    inline int32_t getBytesPerFrame() const { return numChannels * (bitDepth / 8); }
+    inline int32_t getNumFrames() const { return (int32_t) (dataSize / getBytesPerFrame()); }
+};
+
+/*!
+ * Reads the header of a WAV file by walking its chunks up to the data chunk.
+ * @param data The start of the file
+ * @param size Bytes available at @a data, which only has to reach the data chunk's header
+ * @param header Filled in on success
+ * @return false if it isn't a WAV file this game can decode: 8, 16, 24 or 32-bit PCM or 32-bit
+ * float, mono or more
+ */
+bool parseWaveHeader(const uint8_t *data, size_t size, WaveHeader &header);
+
+// The most bytes @a writeWaveHeader writes.
+static constexpr size_t kMaxWaveHeaderBytes = 46;
+
+/*!
+ * Writes the header of a WAV file with a format chunk and then the data chunk's header, so the
+ * samples follow straight on. @a dataOffset is ignored.
+ * @param data Space for @a kMaxWaveHeaderBytes
+ * @return the bytes written, where the samples start
+ */
+size_t writeWaveHeader(const WaveHeader &header, uint8_t *data);
+
+#endif //PAT_PLAY_WAVEHEADER_H
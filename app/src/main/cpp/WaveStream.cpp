@@ -0,0 +1,83 @@
+#include "WaveStream.h"
+
+#include <algorithm>
+
+#include "AudioFile.h"
+
+// Bytes read from the start of the file to find the data chunk. Files with more metadata in front
+// of their samples than this are read again with more.
+static constexpr size_t kHeaderBytes = 4096;
+static constexpr size_t kMaxHeaderBytes = 1 << 20;
+
+std::unique_ptr<WaveStream> WaveStream::open(std::unique_ptr<WaveSource> source) {
+
+    if (!source) {
+        return nullptr;
+    }
+
+    // Read more of the front of the file until it covers the data chunk's header.
+    std::vector<uint8_t> front;
+    WaveHeader header {};
+    auto parsed = false;
+    for (auto size = kHeaderBytes; size <= kMaxHeaderBytes && !parsed; size *= 2) {
+        auto start = front.size();
+        front.resize(size);
+        auto read = source->read(front.data() + start, size - start);
+        front.resize(start + read);
+        parsed = parseWaveHeader(front.data(), front.size(), header);
+        if (read < size - start) {
+            break;
+        }
+    }
+    if (!parsed || !source->seek(header.dataOffset)) {
+        return nullptr;
+    }
+
+    return std::unique_ptr<WaveStream>(new WaveStream(std::move(source), header));
+
+}
+
+int32_t WaveStream::read(float *output, int32_t numFrames) {
+
+    numFrames = std::min(numFrames, getNumFrames() - position_);
+    if (numFrames <= 0) {
+        return 0;
+    }
+
+    auto bytesPerFrame = (size_t) header_.getBytesPerFrame();
+    chunk_.resize(numFrames * bytesPerFrame);
+    numFrames = (int32_t) (source_->read(chunk_.data(), chunk_.size()) / bytesPerFrame);
+    position_ += numFrames;
+
+    // The format is the same for the whole file, so pick the conversion once per chunk. These are
+    // the same ones AudioFile decodes with, so a streamed sound matches a loaded one.
+    using Converter = AudioSampleConverter<float>;
+    auto numSamples = (size_t) numFrames * header_.numChannels;
+    auto isFloat = header_.audioFormat == 3;
+    switch (header_.bitDepth) {
+        case 8:
+            Converter::bytesToSamples<8, false, false>(chunk_.data(), output, numSamples);
+            break;
+        case 16:
+            Converter::bytesToSamples<16, false, false>(chunk_.data(), output, numSamples);
+            break;
+        case 24:
+            Converter::bytesToSamples<24, false, false>(chunk_.data(), output, numSamples);
+            break;
+        default:
+            if (isFloat) {
+                Converter::bytesToSamples<32, false, true>(chunk_.data(), output, numSamples);
+            } else {
+                Converter::bytesToSamples<32, false, false>(chunk_.data(), output, numSamples);
+            }
+            break;
+    }
+
+    return numFrames;
+
+}
+
+bool WaveStream::rewind() {
+    position_ = 0;
+    return source_->seek(header_.dataOffset);
+}
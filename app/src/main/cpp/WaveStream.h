@@ -0,0 +1,83 @@
+#ifndef PAT_PLAY_WAVESTREAM_H
+#define PAT_PLAY_WAVESTREAM_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "WaveHeader.h"
+
+/*!
+ * Where a @a WaveStream reads its bytes from, such as an asset or a file.
+ */
+class WaveSource {
+public:
+
+    virtual ~WaveSource() = default;
+
+    /*!
+     * Reads the next bytes.
+     * @return the bytes read, fewer than @a size at the end
+     */
+    virtual size_t read(void *buffer, size_t size) = 0;
+
+    /*!
+     * Moves to a byte offset from the start.
+     */
+    virtual bool seek(size_t offset) = 0;
+
+};
+
+/*!
+ * Reads a WAV file a chunk at a time, for sounds too long to decode up front like music or
+ * ambience. Only the header is read when it's opened, and each @a read decodes just the frames
+ * asked for, so memory use doesn't grow with the length of the file.
+ *
+ * Reading does I/O, so it's meant for a background thread rather than the audio callback.
+ */
+class WaveStream {
+public:
+
+    /*!
+     * Reads the header and gets ready to read from the first frame.
+     * @return the stream, or null if the source isn't a WAV file that can be decoded
+     */
+    static std::unique_ptr<WaveStream> open(std::unique_ptr<WaveSource> source);
+
+    inline const WaveHeader &getHeader() const { return header_; }
+    inline int32_t getNumChannels() const { return header_.numChannels; }
+    inline int32_t getSampleRate() const { return header_.sampleRate; }
+    inline int32_t getNumFrames() const { return header_.getNumFrames(); }
+
+    /*!
+     * Decodes the next frames.
+     * @param output Space for @a numFrames interleaved frames of @a getNumChannels float samples
+     * @param numFrames Frames wanted
+     * @return the frames decoded, fewer than @a numFrames at the end and 0 once there are none
+     */
+    int32_t read(float *output, int32_t numFrames);
+
+    /*!
+     * Goes back to the first frame, to loop.
+     */
+    bool rewind();
+
+private:
+
+    inline WaveStream(std::unique_ptr<WaveSource> source, const WaveHeader &header):
+            source_(std::move(source)),
+            header_(header),
+            position_(0) {}
+
+    std::unique_ptr<WaveSource> source_;
+    WaveHeader header_;
+
+    // Frames read so far.
+    int32_t position_;
+
+    // Undecoded bytes of the last chunk read.
+    std::vector<uint8_t> chunk_;
+
+};
+
+#endif //PAT_PLAY_WAVESTREAM_H
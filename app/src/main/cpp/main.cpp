@@ -19,14 +19,18 @@ void handle_cmd(android_app *pApp, int32_t cmd) {
     switch (cmd) {
 
         case APP_CMD_INIT_WINDOW:
-            pApp->userData = new Renderer(pApp);
+            // The renderer outlives its windows, so coming back from the background only needs a
+            // new surface rather than a new context and reloading everything.
+            if (pApp->userData) {
+                reinterpret_cast<Renderer *>(pApp->userData)->initWindow();
+            } else {
+                pApp->userData = new Renderer(pApp);
+            }
             break;
 
         case APP_CMD_TERM_WINDOW:
             if (pApp->userData) {
-                auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
-                pApp->userData = nullptr;
-                delete pRenderer;
+                reinterpret_cast<Renderer *>(pApp->userData)->terminateWindow();
             }
             break;
 
@@ -69,8 +73,9 @@ void android_main(struct android_app *pApp) {
         }
 
         // Check if any user data is associated. This is assigned in handle_cmd.
-        if (pApp->userData) {
-            auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
+        // Only run frames while there's a window to draw them to.
+        auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
+        if (pRenderer && pRenderer->hasWindow()) {
             pRenderer->handleInput();
             pRenderer->update();
             pRenderer->render();
@@ -78,6 +83,13 @@ void android_main(struct android_app *pApp) {
         }
 
     } while (!pApp->destroyRequested);
+
+    // The renderer is kept across windows, so it's only cleaned up once the app is done.
+    if (pApp->userData) {
+        auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
+        pApp->userData = nullptr;
+        delete pRenderer;
+    }
 }
 
 }
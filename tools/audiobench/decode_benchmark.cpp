@@ -0,0 +1,158 @@
+/*!
+ * Measures how long AudioFile takes to decode each of the game's WAVs, against the per-sample loop
+ * it used before its decode loops were specialised by format.
+ *
+ *   decode_benchmark [--assets DIR]
+ *
+ * The sounds are the ones in the manifest in the assets directory. Both decodes have to produce
+ * exactly the same samples, or the benchmark fails.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "AudioFile.h"
+#include "SoundBank.h"
+#include "WaveHeader.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+static constexpr int kRepeats = 20;
+
+static volatile float sink;
+
+static std::vector<uint8_t> readFile(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+/*!
+ * The loop AudioFile::decodeWaveFile used before, for comparison: a bit depth branch, a bounds
+ * check and a push_back for every sample.
+ */
+static bool decodeScalar(const std::vector<uint8_t> &fileData, std::vector<std::vector<float>> &samples) {
+
+    WaveHeader header {};
+    if (!parseWaveHeader(fileData.data(), fileData.size(), header)) {
+        return false;
+    }
+
+    auto numChannels = header.numChannels;
+    auto bitDepth = header.bitDepth;
+    auto numBytesPerSample = bitDepth / 8;
+    auto numBytesPerBlock = numChannels * numBytesPerSample;
+    auto numSamples = (int) (header.dataSize / numBytesPerBlock);
+    auto samplesStartIndex = (int) header.dataOffset;
+
+    samples.clear();
+    samples.resize(numChannels);
+    for (int i = 0; i < numSamples; i++) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            size_t sampleIndex = samplesStartIndex + (numBytesPerBlock * i) + channel * numBytesPerSample;
+            if ((sampleIndex + (bitDepth / 8) - 1) >= fileData.size()) {
+                return false;
+            }
+
+            if (bitDepth == 8) {
+                samples[channel].push_back(AudioSampleConverter<float>::unsignedByteToSample(fileData[sampleIndex]));
+            } else if (bitDepth == 16) {
+                auto sampleAsInt = (int16_t) ((fileData[sampleIndex + 1] << 8) | fileData[sampleIndex]);
+                samples[channel].push_back(AudioSampleConverter<float>::sixteenBitIntToSample(sampleAsInt));
+            } else if (bitDepth == 24) {
+                int32_t sampleAsInt = (fileData[sampleIndex + 2] << 16) | (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex];
+                if (sampleAsInt & 0x800000) {
+                    sampleAsInt = sampleAsInt | ~0xFFFFFF;
+                }
+                samples[channel].push_back(AudioSampleConverter<float>::twentyFourBitIntToSample(sampleAsInt));
+            } else if (bitDepth == 32) {
+                int32_t sampleAsInt;
+                memcpy(&sampleAsInt, &fileData[sampleIndex], sizeof(int32_t));
+                if (header.audioFormat == 3) {
+                    float f;
+                    memcpy(&f, &sampleAsInt, sizeof(float));
+                    samples[channel].push_back(f);
+                } else {
+                    samples[channel].push_back(AudioSampleConverter<float>::thirtyTwoBitIntToSample(sampleAsInt));
+                }
+            }
+        }
+    }
+    return true;
+
+}
+
+/*!
+ * Times @a decode @a kRepeats times and returns the fastest run.
+ * @return microseconds per decode
+ */
+template <typename Decode>
+static double timeDecodes(Decode &&decode) {
+    double best = 1e300;
+    for (auto r = 0; r < kRepeats; r++) {
+        auto start = BenchClock::now();
+        decode();
+        std::chrono::duration<double, std::micro> elapsed = BenchClock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+
+    std::string assetsDir = "app/src/main/assets";
+    if (argc == 3 && std::string(argv[1]) == "--assets") {
+        assetsDir = argv[2];
+    }
+
+    auto manifest = readFile(assetsDir + "/sounds.txt");
+    SoundBank bank;
+    if (manifest.empty() || !bank.parseManifest(reinterpret_cast<const char *>(manifest.data()), manifest.size())) {
+        std::fprintf(stderr, "failed to read %s/sounds.txt\n", assetsDir.c_str());
+        return 2;
+    }
+
+    double totalScalar = 0.0;
+    double totalSpecialised = 0.0;
+    for (int32_t sound = 0; sound < bank.getSoundCount(); sound++) {
+        auto &path = bank.getEntry(sound).path;
+        auto fileData = readFile(assetsDir + "/" + path);
+
+        std::vector<std::vector<float>> expected;
+        AudioFile<float> audioFile;
+        audioFile.shouldLogErrorsToConsole(false);
+        if (!decodeScalar(fileData, expected) || !audioFile.loadFromMemory(fileData.data(), fileData.size())) {
+            std::fprintf(stderr, "failed to decode %s\n", path.c_str());
+            return 1;
+        }
+        if (audioFile.samples != expected) {
+            std::fprintf(stderr, "%s decodes differently\n", path.c_str());
+            return 1;
+        }
+
+        auto scalar = timeDecodes([&] {
+            decodeScalar(fileData, expected);
+            sink = expected[0][0];
+        });
+        auto specialised = timeDecodes([&] {
+            audioFile.loadFromMemory(fileData.data(), fileData.size());
+            sink = audioFile.samples[0][0];
+        });
+        totalScalar += scalar;
+        totalSpecialised += specialised;
+
+        std::printf("%-22s %2d-bit %d ch %7d frames   scalar %8.1f us   specialised %8.1f us  (%.2fx)\n",
+                    path.c_str(), audioFile.getBitDepth(), audioFile.getNumChannels(), audioFile.getNumSamplesPerChannel(),
+                    scalar, specialised, scalar / specialised);
+    }
+    std::printf("%-22s %31s scalar %8.1f us   specialised %8.1f us  (%.2fx)\n",
+                "total", "", totalScalar, totalSpecialised, totalScalar / totalSpecialised);
+
+    return 0;
+
+}
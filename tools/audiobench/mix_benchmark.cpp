@@ -0,0 +1,130 @@
+/*!
+ * Measures what the mixer costs per voice for one audio callback burst.
+ *
+ * 192 frames is a typical low latency burst on Android. Prints the cost of the stereo kernel on
+ * its own next to a plain scalar loop, then the cost of whole Mixer renders at a few polyphonies.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Mix.h"
+#include "Mixer.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+static constexpr int32_t kBurstFrames = 192;
+static constexpr int32_t kChannels = 2;
+static constexpr int kRepeats = 5;
+
+// Bursts per timed run. Sounds are long enough that no voice finishes during a run, even after a
+// burst per voice to start them.
+static constexpr int kBursts = 2000;
+static constexpr int kMaxVoices = 32;
+static constexpr int32_t kSoundFrames = kBurstFrames * (kBursts + kMaxVoices + 1);
+
+static volatile float sink;
+
+/*!
+ * The loop the mixer used before it had SIMD kernels, for comparison.
+ */
+static void mixScalar(float *outputBuffer, const std::vector<std::vector<float>> &samples, int32_t cursor, int32_t numFrames) {
+    for (auto f = 0; f < numFrames; f++) {
+        for (auto c = 0; c < kChannels; c++) {
+            outputBuffer[(f * kChannels) + c] += samples[c][cursor + f];
+        }
+    }
+}
+
+static std::vector<std::vector<float>> makeSamples() {
+    std::vector<std::vector<float>> samples(kChannels, std::vector<float>(kSoundFrames));
+    for (auto c = 0; c < kChannels; c++) {
+        for (auto f = 0; f < kSoundFrames; f++) {
+            samples[c][f] = 0.25f * std::sin(0.01f * (float) (f + c));
+        }
+    }
+    return samples;
+}
+
+/*!
+ * Runs @a setup, then times @a burst for each of @a kBursts bursts. Does that @a kRepeats times
+ * and returns the fastest run.
+ * @return nanoseconds per burst
+ */
+template <typename Setup, typename Burst>
+static double timeBursts(Setup &&setup, Burst &&burst) {
+    double best = 1e300;
+    for (auto r = 0; r < kRepeats; r++) {
+        setup();
+        auto start = BenchClock::now();
+        for (auto b = 0; b < kBursts; b++) {
+            burst(b);
+        }
+        std::chrono::duration<double, std::nano> elapsed = BenchClock::now() - start;
+        best = std::min(best, elapsed.count() / kBursts);
+    }
+    return best;
+}
+
+int main() {
+
+    auto samples = makeSamples();
+    auto sound = SoundBuffer::fromPlanar(samples, kChannels, 44100, SampleFormat::Float);
+    auto sound16 = SoundBuffer::fromPlanar(samples, kChannels, 44100, SampleFormat::Int16);
+    std::vector<float> output(kBurstFrames * kChannels);
+
+    std::printf("burst: %d frames, %d channels\n\n", kBurstFrames, kChannels);
+
+    // The kernel on its own, one voice. Cycles through the first 64 bursts of the sound, about the
+    // length of a real one, so the source stays in cache like it would on a device.
+    auto noSetup = [] {};
+    auto scalar = timeBursts(noSetup, [&](int b) {
+        mixScalar(output.data(), samples, (b % 64) * kBurstFrames, kBurstFrames);
+    });
+    auto simd = timeBursts(noSetup, [&](int b) {
+        auto cursor = (b % 64) * kBurstFrames;
+        mixFrames(output.data(), sound.getData() + (cursor * kChannels), kBurstFrames, kChannels, 1.0f, 0.0f);
+    });
+    auto simd16 = timeBursts(noSetup, [&](int b) {
+        auto cursor = (b % 64) * kBurstFrames;
+        mixFrames(output.data(), sound16.getPcm16() + (cursor * kChannels), kBurstFrames, kChannels, 1.0f, 0.0f);
+    });
+    std::printf("kernel  scalar       %8.1f ns/voice/burst\n", scalar);
+    std::printf("kernel  simd float   %8.1f ns/voice/burst  (%.2fx)\n", simd, scalar / simd);
+    std::printf("kernel  simd int16   %8.1f ns/voice/burst  (%.2fx)\n\n", simd16, scalar / simd16);
+    sink = output[0];
+
+    // Whole renders, including clearing the buffer and walking the voice pool.
+    for (auto format : { SampleFormat::Float, SampleFormat::Int16 }) {
+        auto buffer = SoundBuffer::fromPlanar(samples, kChannels, 44100, format);
+        SoundBank bank;
+        auto pat = bank.addSound("pat", 0, "generated");
+        bank.allocate(format, kChannels, 44100, { buffer.getNumFrames() });
+        bank.publish(pat, buffer);
+        for (int voices : { 1, 8, kMaxVoices }) {
+            std::unique_ptr<Mixer> mixer;
+            auto setup = [&] {
+                mixer = std::make_unique<Mixer>(voices);
+                mixer->setBank(&bank);
+                // One trigger per block, since triggers landing in the same block share a voice.
+                for (auto v = 0; v < voices; v++) {
+                    mixer->trigger(pat, 0);
+                    mixer->render(output.data(), kBurstFrames, kChannels, AudioRenderer::kUntimed);
+                }
+            };
+            auto perBurst = timeBursts(setup, [&](int) {
+                mixer->render(output.data(), kBurstFrames, kChannels, AudioRenderer::kUntimed);
+            });
+            auto name = format == SampleFormat::Int16 ? "int16" : "float";
+            std::printf("render  %-5s %2d voices %8.1f ns/burst %8.1f ns/voice/burst\n", name, voices, perBurst, perBurst / voices);
+            sink = output[0];
+        }
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,639 @@
+/*!
+ * Drives the game's mixer offline with a fake audio stream, the way the Oboe callback does on a
+ * device, and replays a scripted storm of triggers through it.
+ *
+ * The mix is written to a WAV to listen to, and the time each callback took is reported as
+ * percentiles along with the headroom left against the real-time deadline of a burst.
+ *
+ *   mixer_harness [--assets DIR] [--scenario taps|storm|rebounds | --script FILE]
+ *                 [--rate HZ] [--burst FRAMES] [--voices N] [--format float|int16] [--out FILE]
+ *                 [--stream WAV] [--record FILE] [--output float|int16]
+ *
+ * Sounds come from the game's manifest in the assets directory. A script has one trigger per line:
+ * the time in milliseconds, then the sound's number in the manifest.
+ *
+ * With --stream, a WAV loops underneath the triggers through a StreamPlayer. With --record, every
+ * burst also goes through the SessionRecorder the game records sessions with. Either way bursts
+ * are paced in real time, so their threads have to keep up the way they would on a device.
+ *
+ * With --output int16, the triggers also go through two mixers writing 16-bit output, the way the
+ * game plays to a stream that's 16-bit natively. One has room for a whole burst and the other has
+ * to mix each burst in pieces. Both are checked against the float mix converted by hand, so every
+ * sample has to round the same as the scalar code. The mixer's limiter keeps the mix in range, so
+ * a sweep past full scale is converted too, which has to clamp.
+ *
+ * Exits with 1 if any output sample goes over full scale, or anything in the 16-bit checks comes
+ * out wrong.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AudioFile.h"
+#include "Mix.h"
+#include "Mixer.h"
+#include "SessionRecorder.h"
+#include "StreamPlayer.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+static constexpr int64_t kNanosPerSecond = 1000000000;
+static constexpr int64_t kNanosPerMillisecond = 1000000;
+
+struct ScriptedTrigger {
+    int64_t timeNs;
+    int32_t sound;
+};
+
+/*!
+ * Stands in for an Oboe stream. Hands the renderer one burst at a time on a simulated clock that
+ * starts at 0, timing each call with the real one.
+ */
+class FakeAudioStream {
+public:
+
+    inline FakeAudioStream(int32_t sampleRate, int32_t numChannels, int32_t framesPerBurst):
+            sampleRate_(sampleRate),
+            numChannels_(numChannels),
+            framesPerBurst_(framesPerBurst),
+            framesWritten_(0),
+            buffer_(framesPerBurst * numChannels) {}
+
+    inline int32_t getSampleRate() const { return sampleRate_; }
+    inline int32_t getChannelCount() const { return numChannels_; }
+    inline int32_t getFramesPerBurst() const { return framesPerBurst_; }
+    inline int64_t getFramesWritten() const { return framesWritten_; }
+
+    /*!
+     * @return the simulated time of the next burst's first frame
+     */
+    inline int64_t getNextBlockNs() const { return toNanos(framesWritten_); }
+
+    /*!
+     * @return how long a callback has before the burst it's filling is due
+     */
+    inline int64_t getDeadlineNs() const { return toNanos(framesPerBurst_); }
+
+    /*!
+     * Has @a renderer fill the next burst, and appends the burst to @a recording.
+     * @return the nanoseconds the renderer took
+     */
+    int64_t renderBurst(AudioRenderer &renderer, std::vector<float> &recording) {
+        auto blockStartNs = getNextBlockNs();
+        auto start = BenchClock::now();
+        renderer.render(buffer_.data(), framesPerBurst_, numChannels_, blockStartNs);
+        auto elapsed = BenchClock::now() - start;
+        framesWritten_ += framesPerBurst_;
+        recording.insert(recording.end(), buffer_.begin(), buffer_.end());
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+private:
+
+    inline int64_t toNanos(int64_t frames) const { return (frames * kNanosPerSecond) / sampleRate_; }
+
+    int32_t sampleRate_;
+    int32_t numChannels_;
+    int32_t framesPerBurst_;
+    int64_t framesWritten_;
+    std::vector<float> buffer_;
+
+};
+
+/*!
+ * Reads a WAV to stream from a file, standing in for an asset.
+ */
+class FileWaveSource: public WaveSource {
+public:
+
+    inline explicit FileWaveSource(FILE *file): file_(file) {}
+
+    inline ~FileWaveSource() override {
+        std::fclose(file_);
+    }
+
+    size_t read(void *buffer, size_t size) override {
+        return std::fread(buffer, 1, size, file_);
+    }
+
+    bool seek(size_t offset) override {
+        return std::fseek(file_, (long) offset, SEEK_SET) == 0;
+    }
+
+private:
+    FILE *file_;
+};
+
+/*!
+ * Mixes the same triggers as the float mixer to 16-bit output, and compares the two.
+ */
+class Pcm16Check {
+public:
+
+    Pcm16Check(const SoundBank &bank, int maxVoices, int32_t sampleRate, int32_t numChannels, int32_t framesPerBurst):
+            whole_(maxVoices),
+            pieces_(maxVoices),
+            numChannels_(numChannels),
+            wholeOutput_(framesPerBurst * numChannels),
+            piecesOutput_(framesPerBurst * numChannels),
+            samples_(0),
+            clampedHigh_(0),
+            clampedLow_(0),
+            sweepMismatches_(0),
+            wholeMismatches_(0),
+            piecesMismatches_(0),
+            maxPiecesError_(0) {
+        for (auto *mixer : { &whole_, &pieces_ }) {
+            mixer->setSampleRate(sampleRate);
+            mixer->setBank(&bank);
+        }
+        whole_.reservePcm16(framesPerBurst, numChannels);
+
+        // An odd length, so every burst is mixed in several pieces and some samples are left
+        // over for the scalar tail of the conversion.
+        piecesFrames_ = std::max(framesPerBurst / 3 | 1, 1);
+        pieces_.reservePcm16(piecesFrames_, numChannels);
+
+        checkSweep();
+    }
+
+    inline void trigger(int32_t sound, int64_t timeNs) {
+        whole_.trigger(sound, timeNs);
+        pieces_.trigger(sound, timeNs);
+    }
+
+    /*!
+     * Renders the next burst to 16-bit and checks it against the float mixer's.
+     */
+    void check(const float *reference, int32_t numFrames, int64_t blockStartNs) {
+        whole_.render(wholeOutput_.data(), numFrames, numChannels_, blockStartNs);
+        pieces_.render(piecesOutput_.data(), numFrames, numChannels_, blockStartNs);
+        for (size_t i = 0; i < (size_t) numFrames * numChannels_; i++) {
+            auto expected = toPcm16(reference[i]);
+            wholeMismatches_ += wholeOutput_[i] != expected ? 1 : 0;
+
+            // Pieces carry a fade's gain from one to the next, which can round differently.
+            auto error = std::abs(piecesOutput_[i] - expected);
+            piecesMismatches_ += error > 1 ? 1 : 0;
+            maxPiecesError_ = std::max(maxPiecesError_, error);
+        }
+        samples_ += (size_t) numFrames * numChannels_;
+    }
+
+    /*!
+     * Prints what was checked.
+     * @return whether every sample came out as expected
+     */
+    bool report() const {
+        std::printf("int16       %zu samples\n", samples_);
+        std::printf("  sweep     %zu clamped high, %zu clamped low, %zu mismatches %s\n",
+                    clampedHigh_, clampedLow_, sweepMismatches_, sweepMismatches_ == 0 ? "ok" : "FAIL");
+        std::printf("  whole     %zu mismatches %s\n", wholeMismatches_, wholeMismatches_ == 0 ? "ok" : "FAIL");
+        std::printf("  pieces    %d frames, %zu mismatches, max error %d %s\n",
+                    piecesFrames_, piecesMismatches_, maxPiecesError_, piecesMismatches_ == 0 ? "ok" : "FAIL");
+        return sweepMismatches_ == 0 && wholeMismatches_ == 0 && piecesMismatches_ == 0;
+    }
+
+private:
+
+    /*!
+     * The conversion done by hand, one sample at a time.
+     */
+    static inline int16_t toPcm16(float sample) {
+        return (int16_t) lrintf(std::min(std::max(sample * 32768.0f, -32768.0f), 32767.0f));
+    }
+
+    /*!
+     * Converts a sweep from twice full scale down to twice full scale negative, with the samples
+     * either side of each limit and of a rounding tie in it. An odd length leaves a scalar tail.
+     */
+    void checkSweep() {
+        std::vector<float> sweep;
+        for (auto edge : { 32767.0f, 32767.5f, 32768.0f, -32768.0f, -32768.5f, -32769.0f, 0.5f, -0.5f, 1.5f }) {
+            sweep.push_back(std::nextafter(edge, -65536.0f) / 32768.0f);
+            sweep.push_back(edge / 32768.0f);
+            sweep.push_back(std::nextafter(edge, 65536.0f) / 32768.0f);
+        }
+        for (int i = 0; i <= 1000; i++) {
+            sweep.push_back(2.0f - (float) i * 0.004f);
+        }
+        if (sweep.size() % 2 == 0) {
+            sweep.push_back(3.0f);
+        }
+
+        std::vector<int16_t> output(sweep.size());
+        floatToPcm16(output.data(), sweep.data(), (int32_t) sweep.size());
+        for (size_t i = 0; i < sweep.size(); i++) {
+            auto scaled = sweep[i] * 32768.0f;
+            clampedHigh_ += scaled > 32767.0f ? 1 : 0;
+            clampedLow_ += scaled < -32768.0f ? 1 : 0;
+            sweepMismatches_ += output[i] != toPcm16(sweep[i]) ? 1 : 0;
+        }
+    }
+
+    Mixer whole_;
+    Mixer pieces_;
+    int32_t numChannels_;
+    int32_t piecesFrames_;
+    std::vector<int16_t> wholeOutput_;
+    std::vector<int16_t> piecesOutput_;
+    size_t samples_;
+    size_t clampedHigh_;
+    size_t clampedLow_;
+    size_t sweepMismatches_;
+    size_t wholeMismatches_;
+    size_t piecesMismatches_;
+    int maxPiecesError_;
+};
+
+/*!
+ * The groups the game plays, looked up in the manifest.
+ */
+struct SoundGroups {
+    int32_t pat;
+    int32_t redPat;
+    int32_t explosion;
+    int32_t springPat;
+    int32_t springRebound;
+};
+
+/*!
+ * Decodes a sound file straight out of a read-only mapping of it, the way the game decodes from
+ * an asset's buffer.
+ */
+static bool loadMapped(AudioFile<float> &audioFile, const std::string &path) {
+
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    auto size = (size_t) info.st_size;
+    auto *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    auto loaded = audioFile.loadFromMemory(static_cast<const uint8_t *>(data), size);
+    munmap(data, size);
+    return loaded;
+
+}
+
+/*!
+ * Fills a bank the way Sound does, from the manifest and the WAVs it lists.
+ */
+static bool loadSounds(SoundBank &bank, const std::string &assetsDir, int32_t numChannels, int32_t sampleRate, SampleFormat format) {
+
+    auto manifestPath = assetsDir + "/sounds.txt";
+    std::ifstream manifest(manifestPath);
+    std::string text((std::istreambuf_iterator<char>(manifest)), std::istreambuf_iterator<char>());
+    if (!manifest || !bank.parseManifest(text.data(), text.size())) {
+        std::fprintf(stderr, "failed to read %s\n", manifestPath.c_str());
+        return false;
+    }
+
+    // Everything is decoded up front here, which gives the lengths the bank is laid out with.
+    std::vector<SoundBuffer> buffers;
+    std::vector<int32_t> numFrames;
+    for (int32_t sound = 0; sound < bank.getSoundCount(); sound++) {
+        auto &path = bank.getEntry(sound).path;
+        AudioFile<float> audioFile;
+        audioFile.shouldLogErrorsToConsole(false);
+        if (!loadMapped(audioFile, assetsDir + "/" + path)) {
+            std::fprintf(stderr, "failed to load %s/%s\n", assetsDir.c_str(), path.c_str());
+            return false;
+        }
+        auto buffer = SoundBuffer::fromPlanar(audioFile.samples, numChannels, (int32_t) audioFile.getSampleRate(), format);
+        if (buffer.getSampleRate() != sampleRate) {
+            buffer = buffer.resampledTo(sampleRate);
+        }
+        numFrames.push_back(buffer.getNumFrames());
+        buffers.push_back(std::move(buffer));
+    }
+
+    if (!bank.allocate(format, numChannels, sampleRate, numFrames)) {
+        return false;
+    }
+    for (int32_t sound = 0; sound < bank.getSoundCount(); sound++) {
+        bank.publish(sound, buffers[sound]);
+    }
+    return true;
+
+}
+
+/*!
+ * Steady tapping: a pat every 120ms, and a red pat every second that explodes a second later.
+ */
+static std::vector<ScriptedTrigger> tapsScenario(const SoundBank &bank, const SoundGroups &groups, int64_t durationNs) {
+    std::vector<ScriptedTrigger> script;
+    for (int64_t t = 0; t < durationNs; t += 120 * kNanosPerMillisecond) {
+        script.push_back({ t, bank.pickVariant(groups.pat, 0) });
+    }
+    for (int64_t t = 0; t < durationNs; t += kNanosPerSecond) {
+        script.push_back({ t + 7 * kNanosPerMillisecond, bank.pickVariant(groups.redPat, 0) });
+        script.push_back({ t + kNanosPerSecond, bank.pickVariant(groups.explosion, 0) });
+    }
+    return script;
+}
+
+/*!
+ * Ten fingers dragging with no cooldowns: every 60Hz game frame fires 20 triggers, mostly pats,
+ * with spring pats, rebounds and the odd explosion mixed in.
+ */
+static std::vector<ScriptedTrigger> stormScenario(const SoundBank &bank, const SoundGroups &groups, int64_t durationNs) {
+    std::vector<ScriptedTrigger> script;
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> pick(0, 99);
+    const int64_t frameNs = kNanosPerSecond / 60;
+    for (int64_t t = 0; t < durationNs; t += frameNs) {
+        for (int i = 0; i < 20; i++) {
+            auto roll = pick(random);
+            auto group = groups.pat;
+            if (roll >= 98) {
+                group = groups.explosion;
+            } else if (roll >= 95) {
+                group = groups.redPat;
+            } else if (roll >= 80) {
+                group = groups.springRebound;
+            } else if (roll >= 65) {
+                group = groups.springPat;
+            }
+            script.push_back({ t, bank.pickVariant(group, random()) });
+        }
+    }
+    return script;
+}
+
+/*!
+ * A screen full of spring pats hitting the edges, with a rebound in every game frame staggered
+ * across the frame.
+ */
+static std::vector<ScriptedTrigger> reboundsScenario(const SoundBank &bank, const SoundGroups &groups, int64_t durationNs) {
+    std::vector<ScriptedTrigger> script;
+    const int64_t frameNs = kNanosPerSecond / 60;
+    int n = 0;
+    for (int64_t t = 0; t < durationNs; t += frameNs / 4, n++) {
+        script.push_back({ t, bank.pickVariant(groups.springRebound, n) });
+    }
+    return script;
+}
+
+static bool readScript(const SoundBank &bank, const std::string &path, std::vector<ScriptedTrigger> &script) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    double ms;
+    int sound;
+    while (file >> ms >> sound) {
+        if (sound < 0 || sound >= bank.getSoundCount()) {
+            std::fprintf(stderr, "bad sound %d in %s\n", sound, path.c_str());
+            return false;
+        }
+        script.push_back({ (int64_t) (ms * kNanosPerMillisecond), sound });
+    }
+    return true;
+}
+
+static bool saveRecording(const std::vector<float> &recording, int32_t numChannels, int32_t sampleRate, const std::string &path) {
+    AudioFile<float> audioFile;
+    audioFile.setAudioBufferSize(numChannels, (int) (recording.size() / numChannels));
+    audioFile.setSampleRate(sampleRate);
+    audioFile.setBitDepth(16);
+    for (size_t i = 0; i < recording.size(); i++) {
+        audioFile.samples[i % numChannels][i / numChannels] = recording[i];
+    }
+    return audioFile.save(path, AudioFileFormat::Wave);
+}
+
+static double percentile(const std::vector<int64_t> &sorted, double p) {
+    auto index = (size_t) std::ceil(p / 100.0 * (double) sorted.size());
+    return (double) sorted[std::min(sorted.size() - 1, index > 0 ? index - 1 : 0)];
+}
+
+int main(int argc, char **argv) {
+
+    std::string assetsDir = "app/src/main/assets";
+    std::string scenario = "storm";
+    std::string scriptPath;
+    std::string outPath = "mixer_harness.wav";
+    std::string streamPath;
+    std::string recordPath;
+    int32_t sampleRate = 48000;
+    int32_t framesPerBurst = 192;
+    int32_t maxVoices = Mixer::kDefaultMaxVoices;
+    auto format = SampleFormat::Int16;
+    auto pcm16Output = false;
+    const int32_t numChannels = 2;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--assets") {
+            assetsDir = value;
+        } else if (option == "--scenario") {
+            scenario = value;
+        } else if (option == "--script") {
+            scriptPath = value;
+        } else if (option == "--rate") {
+            sampleRate = std::atoi(value.c_str());
+        } else if (option == "--burst") {
+            framesPerBurst = std::atoi(value.c_str());
+        } else if (option == "--voices") {
+            maxVoices = std::atoi(value.c_str());
+        } else if (option == "--format") {
+            format = value == "float" ? SampleFormat::Float : SampleFormat::Int16;
+        } else if (option == "--out") {
+            outPath = value;
+        } else if (option == "--stream") {
+            streamPath = value;
+        } else if (option == "--record") {
+            recordPath = value;
+        } else if (option == "--output") {
+            pcm16Output = value == "int16";
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", option.c_str());
+            return 2;
+        }
+    }
+    if (sampleRate <= 0 || framesPerBurst <= 0) {
+        std::fprintf(stderr, "bad rate or burst size\n");
+        return 2;
+    }
+    if (pcm16Output && !streamPath.empty()) {
+        // The stream can only be played by one mixer, so the 16-bit ones would have nothing to match.
+        std::fprintf(stderr, "--output int16 can't be used with --stream\n");
+        return 2;
+    }
+
+    SoundBank bank;
+    if (!loadSounds(bank, assetsDir, numChannels, sampleRate, format)) {
+        return 1;
+    }
+    SoundGroups groups {
+            bank.findGroup("pat"),
+            bank.findGroup("redpat"),
+            bank.findGroup("explosion"),
+            bank.findGroup("springpat"),
+            bank.findGroup("rebound"),
+    };
+
+    // Build the script.
+    const int64_t durationNs = 5 * kNanosPerSecond;
+    std::vector<ScriptedTrigger> script;
+    if (!scriptPath.empty()) {
+        scenario = scriptPath;
+        if (!readScript(bank, scriptPath, script)) {
+            std::fprintf(stderr, "failed to read %s\n", scriptPath.c_str());
+            return 2;
+        }
+    } else if (scenario == "taps") {
+        script = tapsScenario(bank, groups, durationNs);
+    } else if (scenario == "storm") {
+        script = stormScenario(bank, groups, durationNs);
+    } else if (scenario == "rebounds") {
+        script = reboundsScenario(bank, groups, durationNs);
+    } else {
+        std::fprintf(stderr, "unknown scenario %s\n", scenario.c_str());
+        return 2;
+    }
+    std::stable_sort(script.begin(), script.end(), [](const ScriptedTrigger &a, const ScriptedTrigger &b) {
+        return a.timeNs < b.timeNs;
+    });
+
+    AudioStats stats;
+    Mixer mixer(maxVoices);
+    mixer.setStats(&stats);
+    mixer.setSampleRate(sampleRate);
+    mixer.setBank(&bank);
+
+    std::unique_ptr<Pcm16Check> pcm16Check;
+    if (pcm16Output) {
+        pcm16Check = std::make_unique<Pcm16Check>(bank, maxVoices, sampleRate, numChannels, framesPerBurst);
+    }
+
+    std::unique_ptr<StreamPlayer> streamPlayer;
+    if (!streamPath.empty()) {
+        auto *file = std::fopen(streamPath.c_str(), "rb");
+        auto waveStream = file ? WaveStream::open(std::make_unique<FileWaveSource>(file)) : nullptr;
+        if (!waveStream) {
+            std::fprintf(stderr, "failed to open %s to stream\n", streamPath.c_str());
+            return 1;
+        }
+        streamPlayer = std::make_unique<StreamPlayer>(numChannels, sampleRate);
+        streamPlayer->play(std::move(waveStream), true, 0.5f);
+        mixer.setStreamPlayer(streamPlayer.get());
+
+        // Give the prefetch thread the head start it gets on a device while the stream warms up.
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    std::unique_ptr<SessionRecorder> recorder;
+    if (!recordPath.empty()) {
+        recorder = std::make_unique<SessionRecorder>(numChannels, sampleRate);
+        if (!recorder->start(recordPath)) {
+            std::fprintf(stderr, "failed to record to %s\n", recordPath.c_str());
+            return 1;
+        }
+    }
+
+    // Play the script through, plus a second for the tails to ring out. Before each burst, every
+    // trigger the game thread would have made by the end of that burst goes in the queue.
+    FakeAudioStream stream(sampleRate, numChannels, framesPerBurst);
+    auto endNs = (script.empty() ? 0 : script.back().timeNs) + kNanosPerSecond;
+    std::vector<float> recording;
+    std::vector<int64_t> callbackNs;
+    size_t next = 0;
+    size_t dropped = 0;
+    auto wallStart = BenchClock::now();
+    while (stream.getNextBlockNs() < endNs) {
+        if (streamPlayer || recorder) {
+            std::this_thread::sleep_until(wallStart + std::chrono::nanoseconds(stream.getNextBlockNs()));
+        }
+        auto blockEndNs = stream.getNextBlockNs() + stream.getDeadlineNs();
+        for (; next < script.size() && script[next].timeNs < blockEndNs; next++) {
+            if (!mixer.trigger(script[next].sound, script[next].timeNs)) {
+                dropped++;
+            }
+            if (pcm16Check) {
+                pcm16Check->trigger(script[next].sound, script[next].timeNs);
+            }
+        }
+        auto blockStartNs = stream.getNextBlockNs();
+        auto ns = stream.renderBurst(mixer, recording);
+        if (pcm16Check) {
+            pcm16Check->check(&recording[recording.size() - (size_t) framesPerBurst * numChannels], framesPerBurst, blockStartNs);
+        }
+        if (recorder) {
+            recorder->record(&recording[recording.size() - (size_t) framesPerBurst * numChannels], framesPerBurst);
+        }
+        stats.recordCallback(ns, stream.getDeadlineNs(), mixer.getVoiceCount());
+        callbackNs.push_back(ns);
+    }
+
+    // Report.
+    std::vector<int64_t> sorted = callbackNs;
+    std::sort(sorted.begin(), sorted.end());
+    auto deadline = (double) stream.getDeadlineNs();
+    auto peak = 0.0f;
+    size_t clipped = 0;
+    for (auto sample : recording) {
+        peak = std::max(peak, std::abs(sample));
+        clipped += std::abs(sample) > 1.0f ? 1 : 0;
+    }
+
+    std::printf("scenario    %s\n", scenario.c_str());
+    std::printf("stream      %d Hz, %d channels, %d frame bursts, %s samples, %d voices\n",
+                sampleRate, numChannels, framesPerBurst, format == SampleFormat::Float ? "float" : "int16", maxVoices);
+    auto snapshot = stats.snapshot();
+    std::printf("triggers    %zu (%u dropped, %zu of them by a full queue)\n", script.size(), snapshot.droppedTriggers, dropped);
+    std::printf("voices      peak %d\n", snapshot.peakVoices);
+    std::printf("callbacks   %zu, deadline %.1f us\n", sorted.size(), deadline / 1000.0);
+    for (double p : { 50.0, 90.0, 99.0, 99.9, 100.0 }) {
+        auto ns = percentile(sorted, p);
+        std::printf("  p%-6.1f %9.2f us   headroom %6.2f%%\n", p, ns / 1000.0, 100.0 * (1.0 - ns / deadline));
+    }
+    if (recorder) {
+        recorder->stop();
+        std::printf("recorded    %s, %u frames dropped\n", recordPath.c_str(), recorder->getDroppedFrames());
+    }
+    if (streamPlayer) {
+        std::printf("streamed    %s, %u underruns\n", streamPath.c_str(), streamPlayer->getUnderruns());
+    }
+    std::printf("output      peak %.3f, %zu samples over full scale\n", peak, clipped);
+    auto passed = clipped == 0;
+    if (pcm16Check) {
+        passed = pcm16Check->report() && passed;
+    }
+
+    if (!saveRecording(recording, numChannels, sampleRate, outPath)) {
+        std::fprintf(stderr, "failed to write %s\n", outPath.c_str());
+        return 1;
+    }
+    std::printf("wrote       %s\n", outPath.c_str());
+
+    return passed ? 0 : 1;
+
+}
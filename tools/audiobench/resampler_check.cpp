@@ -0,0 +1,109 @@
+/*!
+ * Checks the load time resampler against reference signals with known answers.
+ *
+ * Sines are resampled and compared with the same sine generated directly at the output rate, and
+ * a tone above the output's Nyquist rate must be filtered out rather than aliased. Prints each
+ * measurement, and exits with 1 if any falls short.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Resampler.h"
+
+static bool passed = true;
+
+// Everything the resampler lets through or leaves behind must be at least this far below the signal.
+static constexpr double kMinSnrDb = 90.0;
+static constexpr double kMaxAliasDb = -90.0;
+
+static std::vector<float> makeSine(double frequency, int32_t sampleRate, int32_t numFrames, int32_t numChannels) {
+    std::vector<float> samples(numFrames * numChannels);
+    for (int32_t f = 0; f < numFrames; f++) {
+        for (int32_t c = 0; c < numChannels; c++) {
+            // Offset each channel's phase so a channel mix up would show.
+            samples[(f * numChannels) + c] = (float) (0.5 * std::sin(2.0 * M_PI * frequency * f / sampleRate + c));
+        }
+    }
+    return samples;
+}
+
+static std::vector<float> resample(const std::vector<float> &input, int32_t inputRate, int32_t outputRate, int32_t numChannels) {
+    Resampler resampler(inputRate, outputRate);
+    auto inputFrames = (int32_t) (input.size() / numChannels);
+    std::vector<float> output(resampler.getOutputFrames(inputFrames) * numChannels);
+    resampler.process(input.data(), inputFrames, numChannels, output.data());
+    return output;
+}
+
+static void check(const char *name, bool ok, double value, const char *unit) {
+    std::printf("%-44s %10.2f %-4s %s\n", name, value, unit, ok ? "ok" : "FAIL");
+    passed = passed && ok;
+}
+
+/*!
+ * Signal to error ratio of @a output against @a reference, skipping the edges where the filter
+ * runs off the ends of the input.
+ */
+static double snr(const std::vector<float> &output, const std::vector<float> &reference, size_t skip) {
+    double signal = 0.0;
+    double error = 0.0;
+    for (size_t i = skip; i + skip < output.size() && i < reference.size(); i++) {
+        signal += reference[i] * reference[i];
+        error += (output[i] - reference[i]) * (output[i] - reference[i]);
+    }
+    return 10.0 * std::log10(signal / error);
+}
+
+static double rms(const std::vector<float> &samples, size_t skip) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = skip; i + skip < samples.size(); i++, count++) {
+        sum += samples[i] * samples[i];
+    }
+    return std::sqrt(sum / count);
+}
+
+static void checkSine(int32_t inputRate, int32_t outputRate, double frequency) {
+    const int32_t channels = 2;
+    auto input = makeSine(frequency, inputRate, inputRate / 2, channels);
+    auto output = resample(input, inputRate, outputRate, channels);
+    auto reference = makeSine(frequency, outputRate, (int32_t) (output.size() / channels), channels);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "sine %.0f Hz, %d -> %d", frequency, inputRate, outputRate);
+    auto value = snr(output, reference, 256 * channels);
+    check(name, value > kMinSnrDb, value, "dB");
+}
+
+int main() {
+
+    // Lengths follow the rate ratio exactly.
+    Resampler upsample(44100, 48000);
+    check("frames, 44100 -> 48000 of 44100", upsample.getOutputFrames(44100) == 48000, upsample.getOutputFrames(44100), "");
+    Resampler downsample(48000, 22050);
+    check("frames, 48000 -> 22050 of 48001", downsample.getOutputFrames(48001) == 22051, downsample.getOutputFrames(48001), "");
+
+    // DC passes through at unity gain.
+    std::vector<float> dc(4410, 0.25f);
+    auto dcOut = resample(dc, 44100, 48000, 1);
+    auto dcError = std::abs(dcOut[dcOut.size() / 2] - 0.25f);
+    check("dc error, 44100 -> 48000", dcError < 1e-5, dcError * 1e6, "ppm");
+
+    // Tones well inside the passband come through unchanged.
+    checkSine(44100, 48000, 1000.0);
+    checkSine(44100, 48000, 12000.0);
+    checkSine(48000, 44100, 1000.0);
+    checkSine(22050, 48000, 440.0);
+    checkSine(44100, 44101, 3000.0);
+
+    // A tone the output can't represent is removed instead of folding back down.
+    auto tone = makeSine(23000.0, 48000, 24000, 1);
+    auto aliased = resample(tone, 48000, 44100, 1);
+    auto rejection = 20.0 * std::log10(rms(aliased, 256) / rms(tone, 256));
+    check("23 kHz rejection, 48000 -> 44100", rejection < kMaxAliasDb, rejection, "dB");
+
+    return passed ? 0 : 1;
+
+}